@@ -0,0 +1,74 @@
+#include <atomic>
+#include <cstdio>
+
+#include "utils/alloc_tracker.h"
+#include "utils/job_scheduler.h"
+
+// 预热后每帧重复提交和新建job，统计所有线程的堆分配次数，稳定运行时应为0
+// 需要定义DT_ALLOC_TRACKING，见CMakeLists
+namespace
+{
+    constexpr uint32_t WARMUP_FRAME_COUNT = 200;
+    constexpr uint32_t FRAME_COUNT = 2000;
+}
+
+int main()
+{
+    std::atomic<uint64_t> sum = 0;
+
+    {
+        dt::JobScheduler scheduler;
+
+        // 每帧重复提交的job和它的后继
+        auto reused = dt::Job::CreateParallel(4096, [&sum](const uint32_t start, const uint32_t end)
+        {
+            sum.fetch_add(end - start, std::memory_order_relaxed);
+        });
+        auto next = dt::Job::CreateCommon([&sum]
+        {
+            sum.fetch_add(1, std::memory_order_relaxed);
+        });
+        next->DependsOn(reused);
+
+        auto runFrames = [&](const uint32_t frameCount)
+        {
+            for (uint32_t i = 0; i < frameCount; ++i)
+            {
+                scheduler.Schedule(reused);
+                next->WaitForStop(i % 2 == 0);
+
+                // 每帧新建的job
+                auto parallel = dt::Job::CreateParallel(1024, [&sum](const uint32_t start, const uint32_t end)
+                {
+                    sum.fetch_add(end - start, std::memory_order_relaxed);
+                });
+                scheduler.Schedule(parallel);
+                parallel->WaitForStop(true);
+
+                auto common = dt::Job::CreateCommon([&sum]
+                {
+                    sum.fetch_add(1, std::memory_order_relaxed);
+                });
+                scheduler.Schedule(common);
+                common->WaitForStop();
+            }
+        };
+
+        runFrames(WARMUP_FRAME_COUNT);
+
+        dt::AllocTracker::BeginFrame();
+        runFrames(FRAME_COUNT);
+        dt::AllocTracker::BeginFrame();
+
+        auto stats = dt::AllocTracker::GetFrameStats();
+        printf("workers=%u frames=%u jobs=%u allocs=%llu bytes=%llu\n",
+            scheduler.GetThreadCount(), FRAME_COUNT, FRAME_COUNT * 3,
+            static_cast<unsigned long long>(stats.allocCount),
+            static_cast<unsigned long long>(stats.allocSizeB));
+    }
+
+    auto expected = static_cast<uint64_t>(WARMUP_FRAME_COUNT + FRAME_COUNT) * (4096 + 1 + 1024 + 1);
+    printf("sum=%llu expected=%llu\n", static_cast<unsigned long long>(sum.load()), static_cast<unsigned long long>(expected));
+
+    return sum.load() == expected ? 0 : 1;
+}
@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "common/utils.h"
+#include "utils/job_scheduler.h"
+
+// 100k个元素的并行job，对比WaitForStop阻塞等待和帮忙执行的耗时
+// 参数为worker数量，不传时使用JobScheduler的默认值
+namespace
+{
+    constexpr uint32_t ELEM_COUNT = 100000;
+    constexpr uint32_t WARMUP_COUNT = 20;
+    constexpr uint32_t RUN_COUNT = 100;
+
+    void Work(dt::vec<float>& data, const uint32_t start, const uint32_t end)
+    {
+        for (auto i = start; i < end; ++i)
+        {
+            auto x = static_cast<float>(i);
+            for (int k = 0; k < 20; ++k)
+            {
+                x = std::sqrt(x + static_cast<float>(k));
+            }
+            data[i] = x;
+        }
+    }
+
+    struct Stats
+    {
+        double median;
+        double p10;
+        double p90;
+    };
+
+    Stats ToStats(dt::vec<double>& times)
+    {
+        std::sort(times.begin(), times.end());
+        return { times[times.size() / 2], times[times.size() / 10], times[times.size() * 9 / 10] };
+    }
+
+    Stats MeasureJob(dt::JobScheduler& scheduler, dt::vec<float>& data, const bool help)
+    {
+        auto job = dt::Job::CreateParallel(ELEM_COUNT, [&data](const uint32_t start, const uint32_t end)
+        {
+            Work(data, start, end);
+        });
+
+        dt::vec<double> times;
+        for (uint32_t i = 0; i < WARMUP_COUNT + RUN_COUNT; ++i)
+        {
+            auto start = std::chrono::steady_clock::now();
+            scheduler.Schedule(job);
+            job->WaitForStop(help);
+            auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            // 前几次用于调整batch大小
+            if (i >= WARMUP_COUNT)
+            {
+                times.push_back(ms);
+            }
+        }
+
+        return ToStats(times);
+    }
+
+    Stats MeasureInline(dt::vec<float>& data)
+    {
+        dt::vec<double> times;
+        for (uint32_t i = 0; i < RUN_COUNT; ++i)
+        {
+            auto start = std::chrono::steady_clock::now();
+            Work(data, 0, ELEM_COUNT);
+            times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+
+        return ToStats(times);
+    }
+
+    void Print(const char* name, const Stats& stats)
+    {
+        printf("%-20s median %6.2f ms  p10 %6.2f  p90 %6.2f\n", name, stats.median, stats.p10, stats.p90);
+    }
+}
+
+int main(const int argc, char** argv)
+{
+    auto threadCount = argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 0u;
+
+    dt::JobScheduler scheduler(threadCount);
+    dt::vec<float> data(ELEM_COUNT);
+
+    printf("hardware_concurrency=%u workers=%u elements=%u runs=%u\n",
+        std::thread::hardware_concurrency(), scheduler.GetThreadCount(), ELEM_COUNT, RUN_COUNT);
+
+    Print("WaitForStop(false)", MeasureJob(scheduler, data, false));
+    Print("WaitForStop(true)", MeasureJob(scheduler, data, true));
+    Print("inline", MeasureInline(data));
+
+    return 0;
+}
@@ -0,0 +1,207 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+#include "utils/thread_pool.h"
+
+// ThreadPool和原来的单锁优先队列线程池在几种提交方式下的吞吐对比
+namespace
+{
+    // 改动前的实现：一把锁保护的优先队列，每次提交notify_all
+    class LockedQueuePool
+    {
+        using Task = std::function<void()>;
+
+        struct CompareByPriority
+        {
+            bool operator()(const std::pair<int32_t, Task>& a, const std::pair<int32_t, Task>& b) const
+            {
+                return a.first < b.first;
+            }
+        };
+
+    public:
+        explicit LockedQueuePool(const uint32_t numThreads)
+        {
+            for (uint32_t i = 0; i < numThreads; ++i)
+            {
+                m_threads.emplace_back(&LockedQueuePool::Worker, this);
+            }
+        }
+
+        ~LockedQueuePool()
+        {
+            {
+                std::lock_guard lock(m_taskMutex);
+                m_shutdown = true;
+                m_taskCond.notify_all();
+            }
+
+            for (auto& thread : m_threads)
+            {
+                thread.join();
+            }
+        }
+
+        template <typename F>
+        void Run(F&& task, const int32_t priority = 0)
+        {
+            std::lock_guard lock(m_taskMutex);
+            m_tasks.emplace(priority, std::forward<F>(task));
+            m_taskCond.notify_all();
+        }
+
+        template <typename F>
+        void RunMany(const F& task, const uint32_t count, const int32_t priority = 0)
+        {
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                Run(task, priority);
+            }
+        }
+
+    private:
+        std::vector<std::thread> m_threads;
+        std::priority_queue<std::pair<int32_t, Task>, std::vector<std::pair<int32_t, Task>>, CompareByPriority> m_tasks;
+        std::mutex m_taskMutex;
+        std::condition_variable m_taskCond;
+        bool m_shutdown = false;
+
+        void Worker()
+        {
+            while (true)
+            {
+                Task task;
+
+                {
+                    std::unique_lock lock(m_taskMutex);
+                    m_taskCond.wait(lock, [this]
+                    {
+                        return m_shutdown || !m_tasks.empty();
+                    });
+
+                    if (m_shutdown)
+                    {
+                        return;
+                    }
+
+                    task = m_tasks.top().second;
+                    m_tasks.pop();
+                }
+
+                task();
+            }
+        }
+    };
+
+    constexpr uint32_t TASK_COUNT = 200000;
+    constexpr uint32_t REPEAT_COUNT = 5;
+    // 每个task做少量计算，模拟拆分很细的并行job
+    constexpr uint32_t TASK_WORK = 64;
+
+    void DoWork(std::atomic<uint32_t>& done)
+    {
+        volatile uint32_t x = 0;
+        for (uint32_t i = 0; i < TASK_WORK; ++i)
+        {
+            x = x + i;
+        }
+        done.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void WaitDone(const std::atomic<uint32_t>& done)
+    {
+        while (done.load(std::memory_order_acquire) < TASK_COUNT)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    // 主线程逐个提交
+    template <typename Pool>
+    void SubmitExternal(Pool& pool, std::atomic<uint32_t>& done)
+    {
+        for (uint32_t i = 0; i < TASK_COUNT; ++i)
+        {
+            pool.Run([&done] { DoWork(done); });
+        }
+    }
+
+    // 由一个worker逐个提交，和JobScheduler在job里调度后续job一样
+    template <typename Pool>
+    void SubmitFanOut(Pool& pool, std::atomic<uint32_t>& done)
+    {
+        pool.Run([&pool, &done]
+        {
+            for (uint32_t i = 0; i < TASK_COUNT; ++i)
+            {
+                pool.Run([&done] { DoWork(done); });
+            }
+        });
+    }
+
+    // 由一个worker分多批一次提交，和ScheduleParallelJob一样
+    template <typename Pool>
+    void SubmitBatched(Pool& pool, std::atomic<uint32_t>& done)
+    {
+        constexpr uint32_t batchSize = 64;
+        pool.Run([&pool, &done]
+        {
+            for (uint32_t i = 0; i < TASK_COUNT; i += batchSize)
+            {
+                pool.RunMany([&done] { DoWork(done); }, batchSize);
+            }
+        });
+    }
+
+    template <typename Pool, typename Submit>
+    double Measure(const uint32_t threadCount, Submit submit)
+    {
+        auto best = 1e30;
+        for (uint32_t r = 0; r < REPEAT_COUNT; ++r)
+        {
+            std::atomic<uint32_t> done = 0;
+            Pool pool(threadCount);
+
+            auto start = std::chrono::steady_clock::now();
+            submit(pool, done);
+            WaitDone(done);
+            auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            best = (std::min)(best, ms);
+        }
+
+        return best;
+    }
+
+    template <typename Submit>
+    void Compare(const char* name, const uint32_t threadCount, Submit submit)
+    {
+        auto oldMs = Measure<LockedQueuePool>(threadCount, submit);
+        auto newMs = Measure<dt::ThreadPool>(threadCount, submit);
+        printf("%-9s threads=%2u  locked=%8.1f ms (%6.2f Mtask/s)  deque=%8.1f ms (%6.2f Mtask/s)  x%.2f\n",
+            name, threadCount,
+            oldMs, TASK_COUNT / oldMs / 1000.0,
+            newMs, TASK_COUNT / newMs / 1000.0,
+            oldMs / newMs);
+    }
+}
+
+int main()
+{
+    auto coreCount = (std::max)(std::thread::hardware_concurrency(), 1u);
+    printf("hardware_concurrency=%u tasks=%u best of %u\n", coreCount, TASK_COUNT, REPEAT_COUNT);
+
+    for (uint32_t threadCount = 1; threadCount <= coreCount * 2; threadCount *= 2)
+    {
+        Compare("external", threadCount, [](auto& pool, auto& done) { SubmitExternal(pool, done); });
+        Compare("fan-out", threadCount, [](auto& pool, auto& done) { SubmitFanOut(pool, done); });
+        Compare("batched", threadCount, [](auto& pool, auto& done) { SubmitBatched(pool, done); });
+    }
+
+    return 0;
+}
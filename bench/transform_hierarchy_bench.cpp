@@ -0,0 +1,268 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+
+#include "common/math.h"
+#include "utils/job_scheduler.h"
+
+using namespace DirectX;
+
+// 10k/100k/1M个物体每帧全部移动后更新矩阵，对比三种方式：
+// recursive: 改动前的TransformComp，按无序集合的顺序递归更新父物体，XMMatrixTransformation加完整的XMMatrixInverse
+// levels: 现在的TransformComp，按深度排好序的连续数组逐层更新，ComposeTrs加InverseAffine
+// levels+jobs: 同上，每层数量达到PARALLEL_MIN_COUNT时用JobScheduler并行
+// 物体和TransformComp一样单独分配，矩阵存在物体里；参数为worker数量，不传时使用JobScheduler的默认值
+namespace
+{
+    constexpr uint32_t NODE_COUNTS[] = { 10000, 100000, 1000000 };
+    constexpr uint32_t CHILD_COUNT = 4;
+    constexpr uint32_t ROOT_RATIO = 256;
+    constexpr uint32_t PARALLEL_MIN_COUNT = 256;
+    constexpr uint32_t WARMUP_COUNT = 3;
+    constexpr uint32_t RUN_COUNT = 15;
+    static_assert((WARMUP_COUNT + RUN_COUNT) % 2 == 0);
+
+    struct Node
+    {
+        Node* parent = nullptr;
+        bool dirty = true;
+        XMVECTOR position = XMVectorZero();
+        XMVECTOR rotation = XMQuaternionIdentity();
+        XMVECTOR scale = XMVectorReplicate(1.0f);
+        XMMATRIX localToWorld = XMMatrixIdentity();
+        XMMATRIX worldToLocal = XMMatrixIdentity();
+        bool hasOddNegativeScale = false;
+    };
+
+    struct UpdatingNode
+    {
+        Node* node;
+        const Node* parent;
+    };
+
+    struct Hierarchy
+    {
+        dt::vec<dt::up<Node>> nodes;
+        // 模拟unordered_set<sp<TransformComp>>的遍历顺序
+        dt::vec<Node*> shuffledNodes;
+        // 按深度排好序，levelEnds[i]为第i层的结束位置
+        dt::vec<UpdatingNode> updatingNodes;
+        dt::vec<uint32_t> levelEnds;
+    };
+
+    // 前nodeCount / ROOT_RATIO个是根物体，其余的父物体是前面的第(i - rootCount) / CHILD_COUNT个，下标顺序就是深度顺序
+    Hierarchy CreateHierarchy(const uint32_t nodeCount)
+    {
+        Hierarchy hierarchy;
+        auto rootCount = (std::max)(nodeCount / ROOT_RATIO, 1u);
+        std::mt19937 rng(nodeCount);
+        std::uniform_real_distribution dist(-1.0f, 1.0f);
+
+        dt::vec<uint32_t> depths(nodeCount);
+        for (uint32_t i = 0; i < nodeCount; ++i)
+        {
+            auto node = std::make_unique<Node>();
+            if (i >= rootCount)
+            {
+                auto parentIndex = (i - rootCount) / CHILD_COUNT;
+                node->parent = hierarchy.nodes[parentIndex].get();
+                depths[i] = depths[parentIndex] + 1;
+            }
+            node->position = XMVectorSet(dist(rng) * 10, dist(rng) * 10, dist(rng) * 10, 0);
+            node->rotation = XMQuaternionNormalize(XMVectorSet(dist(rng), dist(rng), dist(rng), dist(rng) + 1.5f));
+            node->scale = XMVectorSet(1.0f + dist(rng) * 0.2f, 1.0f + dist(rng) * 0.2f, 1.0f + dist(rng) * 0.2f, 0);
+            hierarchy.nodes.push_back(std::move(node));
+        }
+
+        for (auto& node : hierarchy.nodes)
+        {
+            hierarchy.shuffledNodes.push_back(node.get());
+        }
+        std::shuffle(hierarchy.shuffledNodes.begin(), hierarchy.shuffledNodes.end(), rng);
+
+        for (uint32_t i = 0; i < nodeCount; ++i)
+        {
+            if (i > 0 && depths[i] != depths[i - 1])
+            {
+                hierarchy.levelEnds.push_back(i);
+            }
+            hierarchy.updatingNodes.push_back({ hierarchy.nodes[i].get(), hierarchy.nodes[i]->parent });
+        }
+        hierarchy.levelEnds.push_back(nodeCount);
+
+        return hierarchy;
+    }
+
+    // 来回移动，WARMUP_COUNT + RUN_COUNT为偶数，每种方式测完后物体回到原位，结果可以互相比较
+    void MoveAll(Hierarchy& hierarchy, const uint32_t frame)
+    {
+        auto offset = XMVectorReplicate(frame % 2 == 0 ? 0.01f : -0.01f);
+        for (auto& node : hierarchy.nodes)
+        {
+            node->position = XMVectorAdd(node->position, offset);
+            node->dirty = true;
+        }
+    }
+
+    void UpdateRecursive(Node* node)
+    {
+        if (!node->dirty)
+        {
+            return;
+        }
+
+        if (node->parent)
+        {
+            UpdateRecursive(node->parent);
+        }
+
+        node->dirty = false;
+        auto objectMatrix = XMMatrixTransformation(g_XMZero, XMQuaternionIdentity(), node->scale, g_XMZero, node->rotation, node->position);
+        node->localToWorld = node->parent ? XMMatrixMultiply(objectMatrix, node->parent->localToWorld) : objectMatrix;
+
+        XMVECTOR det;
+        node->worldToLocal = XMMatrixInverse(&det, node->localToWorld);
+        node->hasOddNegativeScale = XMVectorGetX(det) < 0;
+    }
+
+    void ComputeMatrix(Node* node, const Node* parent)
+    {
+        node->dirty = false;
+        auto objectMatrix = dt::ComposeTrs(node->scale, node->rotation, node->position);
+        node->localToWorld = parent ? XMMatrixMultiply(objectMatrix, parent->localToWorld) : objectMatrix;
+
+        float det;
+        node->worldToLocal = dt::InverseAffine(node->localToWorld, det);
+        node->hasOddNegativeScale = det < 0;
+    }
+
+    void UpdateLevels(Hierarchy& hierarchy, dt::JobScheduler* scheduler)
+    {
+        uint32_t levelStart = 0;
+        for (auto levelEnd : hierarchy.levelEnds)
+        {
+            auto count = levelEnd - levelStart;
+            if (!scheduler || count < PARALLEL_MIN_COUNT)
+            {
+                for (auto i = levelStart; i < levelEnd; ++i)
+                {
+                    ComputeMatrix(hierarchy.updatingNodes[i].node, hierarchy.updatingNodes[i].parent);
+                }
+            }
+            else
+            {
+                auto job = dt::Job::CreateParallel(count, [&hierarchy, levelStart](const uint32_t start, const uint32_t end)
+                {
+                    for (auto i = levelStart + start; i < levelStart + end; ++i)
+                    {
+                        ComputeMatrix(hierarchy.updatingNodes[i].node, hierarchy.updatingNodes[i].parent);
+                    }
+                });
+                scheduler->Schedule(job);
+                job->WaitForStop(true);
+            }
+
+            levelStart = levelEnd;
+        }
+    }
+
+    struct Stats
+    {
+        double median;
+        double p10;
+        double p90;
+    };
+
+    template <typename Update>
+    Stats Measure(Hierarchy& hierarchy, Update update)
+    {
+        dt::vec<double> times;
+        for (uint32_t i = 0; i < WARMUP_COUNT + RUN_COUNT; ++i)
+        {
+            MoveAll(hierarchy, i);
+
+            auto start = std::chrono::steady_clock::now();
+            update();
+            auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            if (i >= WARMUP_COUNT)
+            {
+                times.push_back(ms);
+            }
+        }
+
+        std::sort(times.begin(), times.end());
+        return { times[times.size() / 2], times[times.size() / 10], times[times.size() * 9 / 10] };
+    }
+
+    dt::vec<XMFLOAT4X4> Snapshot(const Hierarchy& hierarchy)
+    {
+        dt::vec<XMFLOAT4X4> result;
+        for (auto& node : hierarchy.nodes)
+        {
+            result.push_back(dt::Store(node->worldToLocal));
+        }
+        return result;
+    }
+
+    float MaxDifference(const dt::vec<XMFLOAT4X4>& a, const dt::vec<XMFLOAT4X4>& b)
+    {
+        float maxDiff = 0;
+        for (size_t i = 0; i < a.size(); ++i)
+        {
+            for (int row = 0; row < 4; ++row)
+            {
+                for (int col = 0; col < 4; ++col)
+                {
+                    maxDiff = (std::max)(maxDiff, std::abs(a[i].m[row][col] - b[i].m[row][col]));
+                }
+            }
+        }
+        return maxDiff;
+    }
+
+    void Print(const char* name, const Stats& stats, const double baseline)
+    {
+        printf("  %-12s median %8.2f ms  p10 %8.2f  p90 %8.2f  x%.2f\n", name, stats.median, stats.p10, stats.p90, baseline / stats.median);
+    }
+}
+
+int main(const int argc, char** argv)
+{
+    auto threadCount = argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 0u;
+    dt::JobScheduler scheduler(threadCount);
+
+    printf("hardware_concurrency=%u workers=%u runs=%u\n", std::thread::hardware_concurrency(), scheduler.GetThreadCount(), RUN_COUNT);
+
+    for (auto nodeCount : NODE_COUNTS)
+    {
+        auto hierarchy = CreateHierarchy(nodeCount);
+        printf("nodes=%u levels=%zu\n", nodeCount, hierarchy.levelEnds.size());
+
+        auto recursive = Measure(hierarchy, [&hierarchy]
+        {
+            for (auto node : hierarchy.shuffledNodes)
+            {
+                UpdateRecursive(node);
+            }
+        });
+        auto expected = Snapshot(hierarchy);
+
+        auto levels = Measure(hierarchy, [&hierarchy] { UpdateLevels(hierarchy, nullptr); });
+        auto levelsDiff = MaxDifference(Snapshot(hierarchy), expected);
+
+        auto levelsJobs = Measure(hierarchy, [&hierarchy, &scheduler] { UpdateLevels(hierarchy, &scheduler); });
+        auto levelsJobsDiff = MaxDifference(Snapshot(hierarchy), expected);
+
+        Print("recursive", recursive, recursive.median);
+        Print("levels", levels, recursive.median);
+        Print("levels+jobs", levelsJobs, recursive.median);
+        printf("  max diff levels=%g levels+jobs=%g\n", levelsDiff, levelsJobsDiff);
+    }
+
+    return 0;
+}
@@ -0,0 +1,107 @@
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+#include "common/math.h"
+
+using namespace DirectX;
+
+// 用随机的缩放、旋转和位移对比ComposeTrs/InverseAffine和DirectXMath的XMMatrixTransformation/XMMatrixInverse
+// 包含非均匀缩放、负缩放和多层父子相乘的矩阵，误差超出容差时返回1
+namespace
+{
+    constexpr uint32_t SAMPLE_COUNT = 100000;
+    constexpr uint32_t HIERARCHY_DEPTH = 8;
+    // 公式写错时误差在1的量级，单精度下正常的舍入误差在1e-4以内
+    constexpr float TOLERANCE = 1e-3f;
+
+    float MaxRelativeError(dt::cr<XMMATRIX> actual, dt::cr<XMMATRIX> expected)
+    {
+        auto a = dt::Store(actual);
+        auto e = dt::Store(expected);
+        float maxError = 0;
+        for (int row = 0; row < 4; ++row)
+        {
+            for (int col = 0; col < 4; ++col)
+            {
+                auto error = std::abs(a.m[row][col] - e.m[row][col]) / (std::max)(1.0f, std::abs(e.m[row][col]));
+                maxError = (std::max)(maxError, error);
+            }
+        }
+        return maxError;
+    }
+
+    struct Trs
+    {
+        XMVECTOR scale;
+        XMVECTOR rotation;
+        XMVECTOR position;
+    };
+
+    Trs RandomTrs(std::mt19937& rng, const float minScale, const float maxScale, const bool allowNegativeScale)
+    {
+        std::uniform_real_distribution scaleDist(minScale, maxScale);
+        std::uniform_real_distribution unitDist(-1.0f, 1.0f);
+        std::uniform_real_distribution posDist(-100.0f, 100.0f);
+        std::bernoulli_distribution flipDist(allowNegativeScale ? 0.3 : 0.0);
+
+        auto sign = [&] { return flipDist(rng) ? -1.0f : 1.0f; };
+        auto scale = XMVectorSet(scaleDist(rng) * sign(), scaleDist(rng) * sign(), scaleDist(rng) * sign(), 0);
+        auto rotation = XMQuaternionNormalize(XMVectorSet(unitDist(rng), unitDist(rng), unitDist(rng), unitDist(rng) + 1.5f));
+        auto position = XMVectorSet(posDist(rng), posDist(rng), posDist(rng), 0);
+        return { scale, rotation, position };
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(42);
+
+    float composeError = 0;
+    float inverseError = 0;
+    float hierarchyError = 0;
+    uint32_t signMismatchCount = 0;
+
+    for (uint32_t i = 0; i < SAMPLE_COUNT; ++i)
+    {
+        auto trs = RandomTrs(rng, 0.1f, 4.0f, true);
+        auto actual = dt::ComposeTrs(trs.scale, trs.rotation, trs.position);
+        auto expected = XMMatrixTransformation(g_XMZero, XMQuaternionIdentity(), trs.scale, g_XMZero, trs.rotation, trs.position);
+        composeError = (std::max)(composeError, MaxRelativeError(actual, expected));
+
+        float det;
+        auto inverse = dt::InverseAffine(actual, det);
+        XMVECTOR expectedDet;
+        auto expectedInverse = XMMatrixInverse(&expectedDet, expected);
+        inverseError = (std::max)(inverseError, MaxRelativeError(inverse, expectedInverse));
+        if ((det < 0) != (XMVectorGetX(expectedDet) < 0))
+        {
+            signMismatchCount++;
+        }
+    }
+
+    // 和TransformComp一样逐层乘上父矩阵后再求逆，缩放范围小一些，避免多层相乘后行列式小于EPSILON
+    for (uint32_t i = 0; i < SAMPLE_COUNT / HIERARCHY_DEPTH; ++i)
+    {
+        auto actual = XMMatrixIdentity();
+        auto expected = XMMatrixIdentity();
+        for (uint32_t depth = 0; depth < HIERARCHY_DEPTH; ++depth)
+        {
+            auto trs = RandomTrs(rng, 0.7f, 1.4f, true);
+            actual = XMMatrixMultiply(dt::ComposeTrs(trs.scale, trs.rotation, trs.position), actual);
+            expected = XMMatrixMultiply(XMMatrixTransformation(g_XMZero, XMQuaternionIdentity(), trs.scale, g_XMZero, trs.rotation, trs.position), expected);
+
+            float det;
+            auto inverse = dt::InverseAffine(actual, det);
+            hierarchyError = (std::max)(hierarchyError, MaxRelativeError(XMMatrixMultiply(actual, inverse), XMMatrixIdentity()));
+            hierarchyError = (std::max)(hierarchyError, MaxRelativeError(inverse, XMMatrixInverse(nullptr, expected)));
+        }
+    }
+
+    printf("samples=%u compose=%g inverse=%g hierarchy=%g signMismatch=%u tolerance=%g\n",
+        SAMPLE_COUNT, composeError, inverseError, hierarchyError, signMismatchCount, TOLERANCE);
+
+    auto pass = composeError < TOLERANCE && inverseError < TOLERANCE && hierarchyError < TOLERANCE && signMismatchCount == 0;
+    printf(pass ? "PASS\n" : "FAIL\n");
+    return pass ? 0 : 1;
+}
@@ -11,6 +11,9 @@ namespace dt
     public:
         template <typename BasicType, typename CacheType>
         static sp<BasicType> GetFromCache(cr<str> assetPath);
+        // 只读写文件，不同资源可以在多个线程上同时调用
+        template <typename BasicType, typename CacheType>
+        static CacheType LoadCache(crstr assetPath);
 
     private:
         struct AssetCacheMeta
@@ -21,8 +24,6 @@ namespace dt
             void serialize(Archive& ar, unsigned int version);
         };
     
-        template <typename BasicType, typename CacheType>
-        static CacheType LoadCache(crstr assetPath);
         static size_t GetAssetFileHash(crstr assetPath);
         
         static str GetAssetCachePath(cr<str> path);
@@ -12,7 +12,14 @@ namespace dt
 {
     #define TRACY_IDLE_COLOR 0x25281E
 
-    #define JOB_THREAD_COUNT 3
+    #define JOB_RESERVED_THREAD_COUNT 2 // 主线程和渲染线程
+    #define JOB_MIN_THREAD_COUNT 1
+    #define JOB_BATCH_COUNT_PER_THREAD 5
+    #define JOB_FIBER_STACK_SIZE (512 * 1024)
+    #define JOB_BACKGROUND_BUDGET_MS 2.0f // 每帧所有worker执行后台任务的总时间
+
+    #define ALLOC_TRACKER_MAX_THREAD_COUNT 64 // 超出的线程共用最后一组计数
+    #define ALLOC_ASSERT_WARMUP_FRAMES 60 // 这些帧还在加载和创建资源，不检查分配
 
     #define SRV_DESC_POOL_SIZE 0xFFFF
     #define SAMPLER_DESC_POOL_SIZE 0xFF
@@ -25,6 +32,16 @@ namespace dt
     #define RAD2DEG 57.2957795f
     #define EPSILON 1e-6
     
+    // fiber可能在其他线程上恢复，读取线程局部变量的函数不能内联，否则编译器可能沿用挂起前算出的线程局部变量地址
+    // MSVC另外用/GT编译，其他编译器只靠这些函数，fiber中执行的代码都要通过它们访问线程局部变量
+    #if defined(_MSC_VER)
+        #define DT_NOINLINE __declspec(noinline)
+    #elif defined(__clang__)
+        #define DT_NOINLINE __attribute__((noinline))
+    #else
+        #define DT_NOINLINE __attribute__((noinline, noipa))
+    #endif
+    
     #define THROW_ERROR(msg) throw std::runtime_error(format_log(LOG_ERROR, msg));
     #define THROW_ERRORF(msg, ...) throw std::runtime_error(format_log(LOG_ERROR, msg, __VA_ARGS__));
     #define THROW_IF(cond, msg) if (cond) throw std::runtime_error(msg)
@@ -227,7 +227,7 @@ namespace dt
         auto mipmapCount = cache.desc.GetMipmapCount();
         auto subResourcesCount = cache.mipmaps.size();
         const UINT64 uploadBufferSize = GetRequiredIntermediateSize(dxTexture->GetDxResource()->GetResource(), 0, subResourcesCount);
-        auto uploadBuffer = DxResource::GetUploadBuffer(nullptr, uploadBufferSize);
+        auto uploadBuffer = DxResource::GetUploadBuffer(nullptr, uploadBufferSize, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
 
         RT()->AddCmd([dxTexture, cache=std::move(cache), subResourcesCount, mipmapCount, uploadBuffer](ID3D12GraphicsCommandList* cmdList)
         {
@@ -244,8 +244,8 @@ namespace dt
             THROW_IF_FAILED(UpdateSubresources(
                 cmdList,
                 dxTexture->GetDxResource()->GetResource(),
-                uploadBuffer->GetResource(),
-                0,
+                uploadBuffer.resource->GetResource(),
+                uploadBuffer.offsetB,
                 0,
                 subResourcesCount,
                 subresources.data()));
@@ -189,6 +189,48 @@ namespace dt
         return Store(Inverse(Load(m)));
     }
 
+    /// 和XMMatrixTransformation在缩放和旋转中心都为原点时的结果相同，即S * R * T
+    inline XMMATRIX ComposeTrs(cr<XMVECTOR> scale, cr<XMVECTOR> rotation, cr<XMVECTOR> position)
+    {
+        auto result = XMMatrixRotationQuaternion(rotation);
+        result.r[0] = XMVectorMultiply(result.r[0], XMVectorSplatX(scale));
+        result.r[1] = XMVectorMultiply(result.r[1], XMVectorSplatY(scale));
+        result.r[2] = XMVectorMultiply(result.r[2], XMVectorSplatZ(scale));
+        result.r[3] = XMVectorSetW(position, 1.0f);
+        return result;
+    }
+
+    /// 只适用于最后一列为(0, 0, 0, 1)的仿射矩阵，3x3部分用叉积求伴随矩阵，平移部分单独求逆
+    inline XMMATRIX InverseAffine(cr<XMMATRIX> m, float& det)
+    {
+        auto c0 = XMVector3Cross(m.r[1], m.r[2]);
+        auto c1 = XMVector3Cross(m.r[2], m.r[0]);
+        auto c2 = XMVector3Cross(m.r[0], m.r[1]);
+        auto detV = XMVector3Dot(m.r[0], c0);
+        det = XMVectorGetX(detV);
+
+        if (std::abs(det) < EPSILON)
+        {
+            return XMMatrixInverse(nullptr, {
+                XMVectorSet(EPSILON, 0, 0, 0),
+                XMVectorSet(0, EPSILON, 0, 0),
+                XMVectorSet(0, 0, EPSILON, 0),
+                m.r[3]
+            });
+        }
+
+        // c0 c1 c2除以行列式是逆矩阵的列，转置成行
+        auto invDet = XMVectorReciprocal(detV);
+        auto result = XMMatrixTranspose({
+            XMVectorMultiply(c0, invDet),
+            XMVectorMultiply(c1, invDet),
+            XMVectorMultiply(c2, invDet),
+            XMVectorZero()
+        });
+        result.r[3] = XMVectorSetW(XMVectorNegate(XMVector3TransformNormal(m.r[3], result)), 1.0f);
+        return result;
+    }
+
     inline XMVECTOR ToRotation(cr<XMVECTOR> eulerAngles)
     {
         auto eaRadius = Store3(eulerAngles * DEG2RAD);
@@ -14,6 +14,7 @@
 #include "common/math.h"
 #include "common/asset_cache.h"
 #include "game/game_resource.h"
+#include "utils/job_scheduler.h"
 #include "render/directx.h"
 #include "render/dx_buffer.h"
 #include "render/dx_helper.h"
@@ -71,14 +72,69 @@ namespace dt
 
         auto result = AssetCache::GetFromCache<Mesh, Cache>(modelPath);
 
-        GR()->RegisterResource(modelPath, result);
-        result->m_path = modelPath;
-        
-        log_info("Load mesh: %s", modelPath.c_str());
+        RegisterLoadedMesh(modelPath, result);
         
         return result;
     }
 
+    vecsp<Mesh> Mesh::Prefetch(crvec<str> modelPaths)
+    {
+        ZoneScoped;
+
+        vec<str> paths;
+        uset<str> pathSet;
+        for (auto& path : modelPaths)
+        {
+            if (!GR()->GetResource<Mesh>(path) && pathSet.insert(path).second)
+            {
+                paths.push_back(path);
+            }
+        }
+
+        auto count = static_cast<uint32_t>(paths.size());
+        vec<Cache> caches(count);
+        if (count > 1 && GR()->jobScheduler)
+        {
+            auto job = Job::CreateParallel(count, [&paths, &caches](const uint32_t start, const uint32_t end)
+            {
+                for (auto i = start; i < end; ++i)
+                {
+                    caches[i] = AssetCache::LoadCache<Mesh, Cache>(paths[i]);
+                }
+            });
+            job->SetName("Prefetch Meshes");
+            job->SetMinBatchSize(1);
+            GR()->jobScheduler->Schedule(job);
+            job->WaitForStop(true);
+        }
+        else
+        {
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                caches[i] = AssetCache::LoadCache<Mesh, Cache>(paths[i]);
+            }
+        }
+
+        vecsp<Mesh> result;
+        result.reserve(count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            auto mesh = CreateAssetFromCache(std::move(caches[i]));
+            RegisterLoadedMesh(paths[i], mesh);
+            result.push_back(mesh);
+        }
+
+        return result;
+    }
+
+    void Mesh::RegisterLoadedMesh(crstr modelPath, crsp<Mesh> mesh)
+    {
+        GR()->RegisterResource(modelPath, mesh);
+        mesh->m_path = modelPath;
+        
+        log_info("Load mesh: %s", modelPath.c_str());
+    }
+
     Mesh::Cache Mesh::CreateCacheFromAsset(crstr assetPath)
     {
         auto importer = ImportFile(assetPath);
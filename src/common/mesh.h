@@ -38,6 +38,8 @@ namespace dt
         uint32_t GetIndicesCount() const { return static_cast<uint32_t>(GetIndexData().size()); }
 
         static sp<Mesh> LoadFromFile(crstr modelPath);
+        // 在JobScheduler上并行读取缓存，主线程创建GPU资源并注册，返回新加载的网格
+        static vecsp<Mesh> Prefetch(crvec<str> modelPaths);
         
         static Cache CreateCacheFromAsset(crstr assetPath);
         static sp<Mesh> CreateAssetFromCache(Cache&& cache);
@@ -55,6 +57,7 @@ namespace dt
         static up<Assimp::Importer> ImportFile(crstr modelPath);
         static void GetMeshLoadConfig(crstr modelPath, float& initScale, bool& flipWindingOrder);
         static void CalcVertexAttrOffset(umap<VertexAttr, VertexAttrInfo>& vertexAttribInfo);
+        static void RegisterLoadedMesh(crstr modelPath, crsp<Mesh> mesh);
         static sp<Mesh> CreateMesh(
             vec<float>&& vertexData,
             vec<uint32_t>&& indices,
@@ -1,9 +1,11 @@
 ﻿#include "utils.h"
 
 #include <chrono>
+#include <cstdlib>
 #include <iomanip>
 #include <windows.h>
 #include <comdef.h>
+#include <psapi.h>
 #include <filesystem>
 #include <fstream>
 #include <random>
@@ -318,6 +320,36 @@ namespace dt
         return std::this_thread::get_id() == mainTheadId;
     }
 
+    std::optional<uint32_t> Utils::GetEnvUInt(const char* name)
+    {
+        char buffer[32];
+        auto length = GetEnvironmentVariableA(name, buffer, sizeof(buffer));
+        if (length == 0 || length >= sizeof(buffer))
+        {
+            return std::nullopt;
+        }
+
+        char* end = nullptr;
+        auto value = std::strtoul(buffer, &end, 10);
+        if (end == buffer || *end != '\0')
+        {
+            return std::nullopt;
+        }
+
+        return static_cast<uint32_t>(value);
+    }
+
+    size_t Utils::GetPeakPrivateMemoryB()
+    {
+        PROCESS_MEMORY_COUNTERS counters = {};
+        if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        {
+            return 0;
+        }
+
+        return counters.PeakPagefileUsage;
+    }
+
     uint32_t Utils::Log2(const uint32_t v)
     {
         static const uint32_t MultiplyDeBruijnBitPosition[32] =
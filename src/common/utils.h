@@ -66,6 +66,12 @@ namespace dt
 
         static bool IsMainThread();
 
+        // 读取无符号整数环境变量，未设置或不是数字时返回空
+        static std::optional<uint32_t> GetEnvUInt(const char* name);
+
+        // 进程启动以来提交的私有内存的峰值
+        static size_t GetPeakPrivateMemoryB();
+
         static uint32_t Log2(uint32_t v);
 
         static size_t GetRandomSizeT();
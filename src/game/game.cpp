@@ -5,9 +5,13 @@
 #include <tracy/Tracy.hpp>
 
 #include "game_resource.h"
+#include "common/utils.h"
 #include "objects/scene.h"
 #include "render/render_pipeline.h"
 #include "render/batch_rendering/batch_renderer.h"
+#include "utils/alloc_tracker.h"
+#include "utils/frame_arena.h"
+#include "utils/job_scheduler.h"
 
 namespace dt
 {
@@ -22,6 +26,15 @@ namespace dt
         m_gameResource = msp<GameResource>();
         m_gameResource->m_screenWidth = screenWidth;
         m_gameResource->m_screenHeight = screenHeight;
+
+        // 环境变量可以覆盖worker数量、是否绑核和是否使用fiber，便于在不同机器上对比，未设置时worker数量按硬件线程数决定
+        auto jobThreadCount = Utils::GetEnvUInt("DT_JOB_THREAD_COUNT").value_or(0);
+        auto jobPinThreads = Utils::GetEnvUInt("DT_JOB_PIN_THREADS").value_or(0) != 0;
+        auto jobUseFibers = Utils::GetEnvUInt("DT_JOB_FIBERS").value_or(0) != 0;
+        m_jobScheduler = msp<JobScheduler>(jobThreadCount, jobPinThreads, jobUseFibers);
+        m_gameResource->jobScheduler = m_jobScheduler.get();
+        log_info("JobScheduler: %u workers, pin threads %d, fibers %d",
+            m_jobScheduler->GetThreadCount(), jobPinThreads, jobUseFibers);
         
         m_batchRenderer = msp<BatchRenderer>();
 
@@ -36,6 +49,9 @@ namespace dt
         m_scene.reset();
         m_renderPipeline.reset();
         m_batchRenderer.reset();
+        // 之后释放的资源由RecycleBin直接删除，不再提交后台任务
+        m_gameResource->jobScheduler = nullptr;
+        m_jobScheduler.reset();
         m_gameResource.reset();
 
         m_directx.reset();
@@ -46,6 +62,9 @@ namespace dt
         ZoneScoped;
         
         UpdateTime();
+        AllocTracker::BeginFrame();
+        FrameArena::BeginFrame();
+        m_jobScheduler->BeginFrame();
         UpdateComps();
     }
 
@@ -70,25 +89,15 @@ namespace dt
 
     void Game::UpdateComps()
     {
-        auto allComps = GR()->mainScene->GetRegistry()->GetCompStorage()->GetAllComps();
-        for (auto& comp : allComps)
-        {
-            if (comp.expired())
-            {
-                continue;
-            }
-            
-            comp.lock()->CallUpdate();
-        }
+        ZoneScoped;
 
-        for (auto& comp : allComps)
-        {
-            if (comp.expired())
+        // Update和LateUpdate共用Update之前的组件快照，每个阶段结束后的同步点执行延迟的结构变化
+        auto registry = GR()->mainScene->GetRegistry();
+        registry->GetCompStorage()->ForeachCompPhases(
             {
-                continue;
-            }
-            
-            comp.lock()->LateUpdate();
-        }
+                [](Comp* comp) { comp->CallUpdate(); },
+                [](Comp* comp) { comp->LateUpdate(); },
+            },
+            [registry] { registry->FlushDeferred(); });
     }
 }
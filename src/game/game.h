@@ -7,6 +7,7 @@ namespace dt
     class Scene;
     class RenderPipeline;
     class GameResource;
+    class JobScheduler;
 
     class Game
     {
@@ -30,6 +31,7 @@ namespace dt
         sp<Scene> m_scene;
         sp<DirectX> m_directx;
         sp<BatchRenderer> m_batchRenderer;
+        sp<JobScheduler> m_jobScheduler;
 
         uint64_t m_frameCount = 0;
         LARGE_INTEGER m_timeCount;
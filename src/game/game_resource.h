@@ -16,6 +16,7 @@ namespace dt
     class Scene;
     class Cbuffer;
     class IResource;
+    class JobScheduler;
 
     class GameResource : public Singleton<GameResource>
     {
@@ -41,6 +42,7 @@ namespace dt
         sp<T> GetResource(cr<StringHandle> path);
 
         Scene* mainScene = nullptr;
+        JobScheduler* jobScheduler = nullptr;
 
         sp<Material> testMat = nullptr;
         sp<Material> blitMat = nullptr;
@@ -151,8 +151,8 @@ namespace dt
             DirectX::Ins()->GetSwapChainDesc().BufferCount,
             DXGI_FORMAT_R8G8B8A8_UNORM,
             DescriptorPool::Ins()->GetSrvDescHeap(),
-            m_imguiSrvHandle->data.cpuHandle,
-            m_imguiSrvHandle->data.gpuHandle);
+            m_imguiSrvHandle.GetData().cpuHandle,
+            m_imguiSrvHandle.GetData().gpuHandle);
         
         ImGuiIO& io = ImGui::GetIO();
         
@@ -57,7 +57,7 @@ namespace dt
         Event<> drawGuiEvent;
 
     private:
-        sp<SrvPool::Handle> m_imguiSrvHandle;
+        SrvPool::Handle m_imguiSrvHandle;
         ImGuiContext* m_mainThreadContext;
     };
 }
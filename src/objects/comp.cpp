@@ -27,6 +27,7 @@ namespace dt
                     auto result = std::make_shared<t>(); \
                     result->m_name = StringHandle(#t); \
                     result->m_type = std::type_index(typeid(t)); \
+                    result->m_typeId = CompStorage::GetTypeId<t>(); \
                     return result; \
                 }; \
                 CompStorage::RegisterComp<t>();
@@ -1,4 +1,5 @@
 ﻿#pragma once
+#include <cassert>
 #include <typeindex>
 
 #include "common/const.h"
@@ -47,8 +48,13 @@ namespace dt
         virtual void OnEnable(){}
         virtual void OnDisable(){}
 
+        // 为true的组件类型在Update和LateUpdate阶段按类型分批在JobScheduler上并行执行
+        // 只能修改自己和所在物体的数据，增删组件和物体、改变父物体等结构变化需要通过SceneRegistry::Defer延迟执行
+        static constexpr bool PARALLEL_UPDATE = false;
+
         Comp() = default;
-        virtual ~Comp() = default;
+        // CompStorage只保存裸指针，析构前必须已经从中移除
+        virtual ~Comp() { assert(m_allIndex == UINT32_MAX); }
         Comp(const Comp& other) = delete;
         Comp(Comp&& other) noexcept = delete;
         Comp& operator=(const Comp& other) = delete;
@@ -67,6 +73,11 @@ namespace dt
         Object* m_owner = nullptr;
         std::type_index m_type = std::type_index(typeid(Comp));
 
+        // 由CompStorage维护
+        uint32_t m_typeId = UINT32_MAX;
+        uint32_t m_poolIndex = UINT32_MAX;
+        uint32_t m_allIndex = UINT32_MAX;
+
         void CallUpdate();
         void Destroy();
         void UpdateRealEnable();
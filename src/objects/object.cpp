@@ -8,13 +8,23 @@ namespace dt
 {
     sp<Object> Object::Create(cr<StringHandle> name, crsp<Object> parent)
     {
-        auto json = nlohmann::json::object();
-        json["name"] = name.Str();
-        json["comps"] = nlohmann::json::array();
-        return Create(json, parent);
+        return Create(name, true, nullptr, 0, parent);
     }
     
     sp<Object> Object::Create(const nlohmann::json& objJson, crsp<Object> parent)
+    {
+        StringHandle name = UNNAMED_OBJECT;
+        try_get_val(objJson, "name", name);
+
+        bool enable = true;
+        try_get_val(objJson, "enable", enable);
+
+        auto& compJsons = objJson.at("comps").get_ref<const nlohmann::json::array_t&>();
+
+        return Create(name, enable, compJsons.data(), compJsons.size(), parent);
+    }
+
+    sp<Object> Object::Create(cr<StringHandle> name, const bool enable, const nlohmann::json* compJsons, const size_t compCount, crsp<Object> parent)
     {
         auto result = msp<Object>();
         
@@ -26,17 +36,11 @@ namespace dt
         {
             result->SetParent(GR()->mainScene->GetRoot());
         }
-        
-        if(objJson.contains("name"))
-        {
-            result->name = objJson["name"].get<std::string>();
-        }
 
-        try_get_val(objJson, "name", result->name);
-
-        try_get_val(objJson, "enable", result->m_enable);
+        result->name = name;
+        result->m_enable = enable;
         
-        result->AddCompsFromJsons(objJson["comps"]);
+        result->AddCompsFromJsons(compJsons, compCount);
         
         return result;
     }
@@ -80,17 +84,22 @@ namespace dt
         {
             if (m_scene)
             {
-                m_scene->GetRegistry()->UnregisterObject(shared_from_this());
+                m_scene->GetRegistry()->UnregisterSubtree(shared_from_this());
             }
 
             m_scene = newParent->m_scene;
 
             if (m_scene)
             {
-                m_scene->GetRegistry()->RegisterObject(shared_from_this());
+                m_scene->GetRegistry()->RegisterSubtree(shared_from_this());
             }
         }
 
+        if (transform)
+        {
+            transform->OnParentChanged();
+        }
+
         UpdateRealEnable();
     }
 
@@ -98,29 +107,27 @@ namespace dt
     {
         auto self = shared_from_this();
 
-        auto children = m_children;
-        for (auto& child : children)
-        {
-            child->Destroy();
-        }
-        
-        for (auto& comp: m_comps)
+        // 只有被销毁的根物体需要从父物体上移除，子物体随整个层级一起拆开
+        if (auto parentObj = parent.lock())
         {
-            comp->Destroy();
-        }
-        
-        if (!parent.expired())
-        {
-            remove(parent.lock()->m_children, shared_from_this());
+            remove(parentObj->m_children, self);
             parent.reset();
         }
 
         if (m_scene)
         {
-            m_scene->GetRegistry()->UnregisterObject(shared_from_this());
+            m_scene->GetRegistry()->DestroySubtree(self);
+            return;
         }
 
+        // 不在场景中的物体没有组件，见BindComp
+        auto children = std::move(m_children);
         m_children.clear();
+        for (auto& child : children)
+        {
+            child->parent.reset();
+            child->Destroy();
+        }
     }
 
     std::string Object::GetPathInScene() const
@@ -191,16 +198,15 @@ namespace dt
         return *result;
     }
 
-    void Object::AddCompsFromJsons(nlohmann::json compJsons)
+    void Object::AddCompsFromJsons(const nlohmann::json* compJsons, const size_t compCount)
     {
         umap<string_hash, sp<Comp>> comps;
 
-        nlohmann::json transformCompJson;
-        transformCompJson["name"] = "TransformComp";
-        compJsons.insert(compJsons.begin(), transformCompJson);
-        
-        for (auto& compJson : compJsons)
+        // 每个物体都有TransformComp，json里没有时用默认值
+        static const nlohmann::json transformCompJson = {{"name", "TransformComp"}};
+        for (size_t i = 0; i <= compCount; ++i)
         {
+            auto& compJson = i == 0 ? transformCompJson : compJsons[i - 1];
             auto compName = get_val<StringHandle>(compJson, "name");
             sp<Comp> comp;
             if (auto it = comps.find(compName.Hash()); it != comps.end())
@@ -278,11 +284,7 @@ namespace dt
             return false;
         }
 
-        if (exists(newParent->m_children, shared_from_this()))
-        {
-            return false;
-        }
-
+        // 已经在newParent的子物体列表里时parent一定等于newParent，上面已经判断过，不需要再扫描子物体列表
         return true;
     }
 }
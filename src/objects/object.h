@@ -46,17 +46,20 @@ namespace dt
         
         static sp<Object> Create(cr<StringHandle> name = UNNAMED_OBJECT, crsp<Object> parent = nullptr);
         static sp<Object> Create(const nlohmann::json& objJson, crsp<Object> parent = nullptr);
+        static sp<Object> Create(cr<StringHandle> name, bool enable, const nlohmann::json* compJsons, size_t compCount, crsp<Object> parent = nullptr);
 
     private:
         vecsp<Comp> m_comps;
         vecsp<Object> m_children;
         Scene* m_scene = nullptr;
+        // 由SceneRegistry维护
+        uint32_t m_registryIndex = UINT32_MAX;
         bool m_enable = true;
         bool m_realEnable = true;
         
         void BindComp(crsp<Comp> comp);
         void UpdateRealEnable();
-        void AddCompsFromJsons(nlohmann::json compJsons);
+        void AddCompsFromJsons(const nlohmann::json* compJsons, size_t compCount);
         bool CheckIfCanBeNewParent(crsp<Object> obj);
         bool IsAnyAncestorOf(crsp<Object> obj);
     };
@@ -57,11 +57,10 @@ namespace dt
         
         ASSERT_THROW(m_mesh && m_material);
 
-        m_renderObject = msp<RenderObject>();
+        m_renderObject = mrp<RenderObject>();
         m_renderObject->mesh = m_mesh;
         m_renderObject->material = m_material;
         m_renderObject->shader = m_material->GetShader();
-        m_renderObject->perObjectCbuffer = msp<Cbuffer>(GR()->GetPredefinedCbuffer(PER_OBJECT_CBUFFER)->GetLayout());
 
         LoadTransformInfo();
 
@@ -71,6 +70,8 @@ namespace dt
         }
         else
         {
+            // 合批的物体从合批的矩阵buffer里取矩阵，只有单独绘制的物体需要per object cbuffer
+            m_renderObject->perObjectCbuffer = msp<Cbuffer>(GR()->GetPredefinedCbuffer(PER_OBJECT_CBUFFER)->GetLayout(), true);
             GetOwner()->GetScene()->GetRenderTree()->Register(m_renderObject);
         }
         
@@ -92,7 +93,7 @@ namespace dt
         {
             GetOwner()->GetScene()->GetRenderTree()->UnRegister(m_renderObject);
         }
-        m_renderObject.reset();
+        m_renderObject.Reset();
     }
 
     const Bounds& RenderComp::GetWorldBounds()
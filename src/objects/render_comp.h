@@ -6,10 +6,10 @@
 #include "common/math.h"
 #include "common/event.h"
 #include "render/cbuffer.h"
+#include "render/render_resources.h"
 
 namespace dt
 {
-    struct RenderObject;
     class Mesh;
     class Material;
 
@@ -26,7 +26,7 @@ namespace dt
         bool HasOddNegativeScale() const;
         sp<Mesh> GetMesh() const { return m_mesh;}
         sp<Material> GetMaterial() const { return m_material;}
-        sp<RenderObject> GetRenderObject() const { return m_renderObject;}
+        rp<RenderObject> GetRenderObject() const { return m_renderObject;}
 
         void LoadFromJson(const nlohmann::json& objJson) override;
 
@@ -36,7 +36,7 @@ namespace dt
         
         sp<Mesh> m_mesh = nullptr;
         sp<Material> m_material = nullptr;
-        sp<RenderObject> m_renderObject = nullptr;
+        rp<RenderObject> m_renderObject = nullptr;
 
         bool m_enableBatch = false;
         bool m_transformDirty = true;
@@ -1,10 +1,12 @@
 #include "scene.h"
 
+#include <chrono>
 #include <filesystem>
 #include <imgui.h>
 #include <tracy/Tracy.hpp>
 
 #include "object.h"
+#include "scene_loader.h"
 #include "test_comp.h"
 #include "transform_comp.h"
 #include "game/game_resource.h"
@@ -68,26 +70,45 @@ namespace dt
         
         ZoneScoped;
 
+        auto startTime = std::chrono::steady_clock::now();
+        auto startPeakMemoryB = Utils::GetPeakPrivateMemoryB();
+
         auto scene = msp<Scene>();
         GR()->mainScene = scene.get();
         
         scene->m_registry = mup<SceneRegistry>(scene.get());
         scene->m_renderTree = mup<RenderTree>();
-        
-        nlohmann::json json = Utils::LoadJson(sceneJsonPath);
 
-        // 合并替换json
+        // 合并替换json需要完整的DOM，没有替换文件时流式解析，DT_SCENE_DOM_LOAD=1时强制用DOM加载，用于对比
         auto p = filesystem::path(sceneJsonPath.CStr());
         auto coverSceneJsonPath = p.parent_path() / (p.stem().generic_string() + "_cover.json");
-        if (exists(coverSceneJsonPath))
+        auto hasCoverSceneJson = exists(coverSceneJsonPath);
+        auto useDom = hasCoverSceneJson || Utils::GetEnvUInt("DT_SCENE_DOM_LOAD").value_or(0) != 0;
+
+        nlohmann::json json;
+        SceneLoader loader;
+        if (useDom)
         {
-            nlohmann::json coverSceneJson = Utils::LoadJson(coverSceneJsonPath.generic_string());
-            Utils::MergeJson(json, coverSceneJson);
-        }
+            json = Utils::LoadJson(sceneJsonPath);
+            if (hasCoverSceneJson)
+            {
+                nlohmann::json coverSceneJson = Utils::LoadJson(coverSceneJsonPath.generic_string());
+                Utils::MergeJson(json, coverSceneJson);
+            }
 
-        if(json.contains("config"))
+            if(json.contains("config"))
+            {
+                scene->LoadSceneConfig(json["config"]);
+            }
+        }
+        else
         {
-            scene->LoadSceneConfig(json["config"]);
+            loader.Parse(sceneJsonPath);
+
+            if (!loader.GetConfig().is_null())
+            {
+                scene->LoadSceneConfig(loader.GetConfig());
+            }
         }
 
         auto rootObj = msp<Object>();
@@ -98,12 +119,27 @@ namespace dt
         scene->m_sceneRoot = rootObj;
         scene->m_sceneRoot->GetOrAddComp("TransformComp");
         scene->m_registry->RegisterObject(scene->m_sceneRoot);
-        LoadChildren(rootObj, json.at("root"));
+        if (useDom)
+        {
+            LoadChildren(rootObj, json.at("root"));
+        }
+        else
+        {
+            auto meshes = loader.PrefetchMeshes();
+            loader.CreateObjects(rootObj);
+        }
 
         scene->m_sceneRoot->GetOrAddComp("SkyboxComp");
 
         GR()->RegisterResource(sceneJsonPath, scene);
         scene->m_path = sceneJsonPath;
+
+        // 峰值只增不减，加载前的峰值更高时增量为0
+        auto loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+        auto peakMemoryB = Utils::GetPeakPrivateMemoryB();
+        log_info("Load scene %s: %s, %.1f ms, peak private memory %.1f MB (+%.1f MB)",
+            sceneJsonPath.CStr(), useDom ? "dom" : "sax + prefetch", loadMs,
+            peakMemoryB / (1024.0 * 1024.0), (peakMemoryB - startPeakMemoryB) / (1024.0 * 1024.0));
         
         return scene;
     }
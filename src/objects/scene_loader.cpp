@@ -0,0 +1,289 @@
+#include "scene_loader.h"
+
+#include <filesystem>
+#include <fstream>
+#include <tracy/Tracy.hpp>
+
+#include "object.h"
+#include "common/mesh.h"
+#include "common/utils.h"
+
+namespace dt
+{
+    class SceneLoader::SaxHandler
+    {
+    public:
+        explicit SaxHandler(SceneLoader* loader) : m_loader(loader) {}
+
+        bool null() { return Scalar(nullptr); }
+        bool boolean(const bool val) { return Scalar(val); }
+        bool number_integer(const nlohmann::json::number_integer_t val) { return Scalar(val); }
+        bool number_unsigned(const nlohmann::json::number_unsigned_t val) { return Scalar(val); }
+        bool number_float(const nlohmann::json::number_float_t val, const std::string&) { return Scalar(val); }
+        bool string(std::string& val) { return Scalar(std::move(val)); }
+        bool binary(nlohmann::json::binary_t& val) { return Scalar(nlohmann::json::binary(std::move(val))); }
+
+        bool key(std::string& val)
+        {
+            if (!m_domStack.empty())
+            {
+                m_domKey = std::move(val);
+                return true;
+            }
+
+            m_key = std::move(val);
+
+            // 不认识的字段按原样构建后丢弃
+            auto frame = m_frames.back();
+            if (frame == Frame::DOCUMENT)
+            {
+                if (m_key == "config")
+                {
+                    m_domRoot = &m_loader->m_config;
+                }
+                else if (m_key != "root")
+                {
+                    m_domRoot = &m_discard;
+                }
+            }
+            else if (frame == Frame::OBJECT)
+            {
+                if (m_key != "name" && m_key != "enable" && m_key != "comps" && m_key != "children")
+                {
+                    m_domRoot = &m_discard;
+                }
+            }
+
+            return true;
+        }
+
+        bool start_object(size_t)
+        {
+            if (auto slot = NextDomSlot())
+            {
+                *slot = nlohmann::json::object();
+                m_domStack.push_back(slot);
+                return true;
+            }
+
+            if (m_frames.empty())
+            {
+                PushFrame(Frame::DOCUMENT, INVALID_INDEX);
+                return true;
+            }
+
+            auto frame = m_frames.back();
+            if (frame == Frame::OBJECT_ARRAY)
+            {
+                auto& objects = m_loader->m_objects;
+                auto& record = objects.emplace_back();
+                record.parentIndex = m_indices.back();
+                PushFrame(Frame::OBJECT, static_cast<uint32_t>(objects.size() - 1));
+                return true;
+            }
+
+            if (frame == Frame::COMP_ARRAY)
+            {
+                auto& comps = m_loader->m_comps;
+                m_loader->m_objects[m_indices.back()].compCount++;
+                auto& comp = comps.emplace_back(nlohmann::json::object());
+                m_domStack.push_back(&comp);
+                return true;
+            }
+
+            THROW_ERRORF("Unexpected object in scene json, key: %s", m_key.c_str())
+        }
+
+        bool end_object()
+        {
+            if (!m_domStack.empty())
+            {
+                m_domStack.pop_back();
+                return true;
+            }
+
+            m_frames.pop_back();
+            m_indices.pop_back();
+            return true;
+        }
+
+        bool start_array(size_t)
+        {
+            if (auto slot = NextDomSlot())
+            {
+                *slot = nlohmann::json::array();
+                m_domStack.push_back(slot);
+                return true;
+            }
+
+            auto frame = m_frames.empty() ? Frame::OBJECT_ARRAY : m_frames.back();
+            if (frame == Frame::DOCUMENT && m_key == "root")
+            {
+                PushFrame(Frame::OBJECT_ARRAY, INVALID_INDEX);
+                return true;
+            }
+
+            if (frame == Frame::OBJECT && m_key == "children")
+            {
+                PushFrame(Frame::OBJECT_ARRAY, m_indices.back());
+                return true;
+            }
+
+            if (frame == Frame::OBJECT && m_key == "comps")
+            {
+                auto index = m_indices.back();
+                auto& record = m_loader->m_objects[index];
+                // 一个物体只有一个comps数组，子物体的组件只会出现在它的前面或后面
+                record.compBegin = static_cast<uint32_t>(m_loader->m_comps.size());
+                record.compCount = 0;
+                PushFrame(Frame::COMP_ARRAY, index);
+                return true;
+            }
+
+            THROW_ERRORF("Unexpected array in scene json, key: %s", m_key.c_str())
+        }
+
+        bool end_array()
+        {
+            return end_object();
+        }
+
+        bool parse_error(size_t position, const std::string&, const nlohmann::json::exception& ex)
+        {
+            THROW_ERRORF("Parse scene json failed at %zu: %s", position, ex.what())
+        }
+
+    private:
+        enum class Frame : uint8_t
+        {
+            DOCUMENT,
+            OBJECT_ARRAY,
+            OBJECT,
+            COMP_ARRAY,
+        };
+
+        SceneLoader* m_loader;
+
+        // 场景结构部分的层级，m_indices对OBJECT_ARRAY是父物体下标，对OBJECT和COMP_ARRAY是物体下标
+        vec<Frame> m_frames;
+        vec<uint32_t> m_indices;
+        std::string m_key;
+
+        // 组件、config和不认识的字段构建成DOM
+        nlohmann::json* m_domRoot = nullptr;
+        vec<nlohmann::json*> m_domStack;
+        std::string m_domKey;
+        nlohmann::json m_discard;
+
+        void PushFrame(const Frame frame, const uint32_t index)
+        {
+            m_frames.push_back(frame);
+            m_indices.push_back(index);
+        }
+
+        // 返回下一个值在DOM中的位置，不在构建DOM时返回nullptr
+        nlohmann::json* NextDomSlot()
+        {
+            if (m_domRoot)
+            {
+                auto result = m_domRoot;
+                m_domRoot = nullptr;
+                return result;
+            }
+
+            if (m_domStack.empty())
+            {
+                return nullptr;
+            }
+
+            auto& top = *m_domStack.back();
+            if (top.is_array())
+            {
+                top.push_back(nullptr);
+                return &top.back();
+            }
+
+            return &top[m_domKey];
+        }
+
+        template <typename T>
+        bool Scalar(T&& val)
+        {
+            if (auto slot = NextDomSlot())
+            {
+                *slot = std::forward<T>(val);
+                return true;
+            }
+
+            if (!m_frames.empty() && m_frames.back() == Frame::OBJECT)
+            {
+                auto& record = m_loader->m_objects[m_indices.back()];
+                if constexpr (std::is_same_v<std::decay_t<T>, std::string>)
+                {
+                    if (m_key == "name")
+                    {
+                        record.name = val;
+                        return true;
+                    }
+                }
+                else if constexpr (std::is_same_v<std::decay_t<T>, bool>)
+                {
+                    if (m_key == "enable")
+                    {
+                        record.enable = val;
+                        return true;
+                    }
+                }
+            }
+
+            THROW_ERRORF("Unexpected value in scene json, key: %s", m_key.c_str())
+        }
+    };
+
+    void SceneLoader::Parse(crstr sceneJsonPath)
+    {
+        ZoneScoped;
+
+        auto absPath = Utils::ToAbsPath(sceneJsonPath);
+        auto estimatedObjectCount = std::filesystem::file_size(absPath) / ESTIMATED_BYTES_PER_OBJECT;
+        m_objects.reserve(estimatedObjectCount);
+        m_comps.reserve(estimatedObjectCount * ESTIMATED_COMPS_PER_OBJECT);
+
+        auto s = std::ifstream(absPath);
+        SaxHandler handler(this);
+        nlohmann::json::sax_parse(s, &handler);
+    }
+
+    vecsp<Mesh> SceneLoader::PrefetchMeshes() const
+    {
+        vec<str> meshPaths;
+        for (auto& comp : m_comps)
+        {
+            str meshPath;
+            if (get_val<str>(comp, "name") == "RenderComp" && try_get_val(comp, "mesh", meshPath))
+            {
+                meshPaths.push_back(std::move(meshPath));
+            }
+        }
+
+        return Mesh::Prefetch(meshPaths);
+    }
+
+    void SceneLoader::CreateObjects(crsp<Object> root) const
+    {
+        ZoneScoped;
+
+        vecsp<Object> objects;
+        objects.reserve(m_objects.size());
+        for (auto& record : m_objects)
+        {
+            auto& parent = record.parentIndex == INVALID_INDEX ? root : objects[record.parentIndex];
+            objects.push_back(Object::Create(
+                record.name,
+                record.enable,
+                m_comps.data() + record.compBegin,
+                record.compCount,
+                parent));
+        }
+    }
+}
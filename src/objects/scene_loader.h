@@ -0,0 +1,52 @@
+#pragma once
+#include "nlohmann/json.hpp"
+
+#include "common/const.h"
+
+namespace dt
+{
+    class Mesh;
+    class Object;
+
+    // 流式解析场景json，物体和组件直接写入预先分配的连续数组，不构建整个场景的DOM
+    // 物体按文档中的先序排列，父物体总在子物体前面
+    class SceneLoader
+    {
+    public:
+        SceneLoader() = default;
+        ~SceneLoader() = default;
+        SceneLoader(const SceneLoader& other) = delete;
+        SceneLoader(SceneLoader&& other) noexcept = delete;
+        SceneLoader& operator=(const SceneLoader& other) = delete;
+        SceneLoader& operator=(SceneLoader&& other) noexcept = delete;
+
+        void Parse(crstr sceneJsonPath);
+        cr<nlohmann::json> GetConfig() const { return m_config; }
+        // 资源只被弱引用注册，返回值需要保持到CreateObjects之后
+        vecsp<Mesh> PrefetchMeshes() const;
+        void CreateObjects(crsp<Object> root) const;
+
+    private:
+        static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+        // 用文件大小估计物体数量。Scene_A平均每个物体约660字节（3.3MB，5014个物体），这里故意取小一些，
+        // 多预留约三成（Scene_A预留6483个），组件更少、每个物体字节数更小的场景解析时也不用扩容
+        static constexpr size_t ESTIMATED_BYTES_PER_OBJECT = 512;
+        static constexpr size_t ESTIMATED_COMPS_PER_OBJECT = 2;
+
+        struct ObjectRecord
+        {
+            StringHandle name = UNNAMED_OBJECT;
+            bool enable = true;
+            uint32_t parentIndex = INVALID_INDEX;
+            uint32_t compBegin = 0;
+            uint32_t compCount = 0;
+        };
+
+        class SaxHandler;
+
+        nlohmann::json m_config;
+        vec<ObjectRecord> m_objects;
+        // 每个组件的json仍然单独构建，组件通过LoadFromJson读取
+        nlohmann::json::array_t m_comps;
+    };
+}
@@ -1,13 +1,108 @@
 #include "scene_registry.h"
 
+#include <tracy/Tracy.hpp>
+
 #include "common/material.h"
 #include "object.h"
+#include "game/game_resource.h"
 #include "objects/render_comp.h"
+#include "utils/job_scheduler.h"
 
 namespace dt
 {
-    umap<std::type_index, CompStorage::CompsAccessor> CompStorage::m_compAccessors = {};
-    
+    namespace
+    {
+        // 按层序收集，父物体总在子物体前面
+        void CollectSubtree(crsp<Object> root, vecsp<Object>& result)
+        {
+            auto begin = result.size();
+            result.push_back(root);
+            for (auto i = begin; i < result.size(); ++i)
+            {
+                for (const auto& child : result[i]->GetChildren())
+                {
+                    result.push_back(child);
+                }
+            }
+        }
+    }
+
+    void CompStorage::ForeachCompPhases(const std::initializer_list<void (*)(Comp* comp)> phases, const func<void()>& onPhaseEnd)
+    {
+        // 遍历期间移除组件只把位置置空，不移动其他组件，快照里的组件下标不变
+        m_foreachDepth++;
+
+        auto count = static_cast<uint32_t>(m_allComps.size());
+        vec<bool> visitedParallelTypes;
+        for (auto phase : phases)
+        {
+            visitedParallelTypes.assign(m_pools.size(), false);
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                auto comp = m_allComps[i];
+                if (!comp)
+                {
+                    continue;
+                }
+
+                auto typeId = comp->m_typeId;
+                if (!s_parallelTypes[typeId])
+                {
+                    phase(comp);
+                }
+                else if (!visitedParallelTypes[typeId])
+                {
+                    visitedParallelTypes[typeId] = true;
+                    ForeachParallelType(typeId, count, phase);
+                }
+            }
+
+            onPhaseEnd();
+        }
+
+        m_foreachDepth--;
+        if (m_foreachDepth == 0 && m_hasRemovedDuringForeach)
+        {
+            CompactAllComps();
+        }
+    }
+
+    void CompStorage::ForeachParallelType(const uint32_t typeId, const uint32_t snapshotCount, void (*func)(Comp* comp))
+    {
+        ZoneScoped;
+
+        m_isParallelForeach = true;
+
+        // 池里还有快照之后才加入的组件，它们在m_allComps里的下标不小于snapshotCount
+        auto pool = m_pools[typeId].get();
+        auto run = [pool, snapshotCount, func](const uint32_t start, const uint32_t end)
+        {
+            for (auto i = start; i < end; ++i)
+            {
+                auto comp = pool->Get(i);
+                if (comp->m_allIndex < snapshotCount)
+                {
+                    func(comp);
+                }
+            }
+        };
+
+        auto count = pool->GetCount();
+        if (count < PARALLEL_MIN_COUNT || !GR()->jobScheduler)
+        {
+            run(0, count);
+        }
+        else
+        {
+            auto job = Job::CreateParallel(count, run);
+            job->SetName("Parallel Comps");
+            GR()->jobScheduler->Schedule(job);
+            job->WaitForStop(true);
+        }
+
+        m_isParallelForeach = false;
+    }
+
     SceneRegistry::SceneRegistry(Scene* scene)
     {
         m_scene = scene;
@@ -16,39 +111,133 @@ namespace dt
     void SceneRegistry::RegisterObject(crsp<Object> obj)
     {
         assert(!ObjectExists(obj));
-        
-        for (const auto& child : obj->GetChildren())
+
+        obj->m_registryIndex = static_cast<uint32_t>(m_objects.size());
+        m_objects.push_back(obj);
+
+        // 和Object::BindComp一致，只加入CompStorage
+        for (const auto& comp : obj->GetComps())
         {
-            RegisterObject(child);
+            m_compStorage.AddComp(comp);
         }
-        
+    }
+
+    void SceneRegistry::UnregisterObject(crsp<Object> obj)
+    {
+        assert(ObjectExists(obj));
+
         for (const auto& comp : obj->GetComps())
         {
             UnregisterComp(comp);
         }
-        
-        m_objects.push_back(obj);
+
+        RemoveObject(obj.get());
     }
 
-    void SceneRegistry::UnregisterObject(crsp<Object> obj)
+    void SceneRegistry::RegisterSubtree(crsp<Object> root)
     {
-        assert(ObjectExists(obj));
+        ZoneScoped;
 
-        for (const auto& child : obj->GetChildren())
+        vecsp<Object> objects;
+        CollectSubtree(root, objects);
+
+        m_objects.reserve(m_objects.size() + objects.size());
+        for (const auto& obj : objects)
         {
-            UnregisterObject(child);
+            obj->m_scene = m_scene;
+            RegisterObject(obj);
         }
-        
-        for (const auto& comp : obj->GetComps())
+    }
+
+    void SceneRegistry::UnregisterSubtree(crsp<Object> root)
+    {
+        ZoneScoped;
+
+        vecsp<Object> objects;
+        CollectSubtree(root, objects);
+
+        for (const auto& obj : objects)
         {
-            UnregisterComp(comp);
+            assert(ObjectExists(obj));
+
+            for (const auto& comp : obj->GetComps())
+            {
+                m_compStorage.RemoveComp(comp);
+            }
+            RemoveObject(obj.get());
+        }
+
+        RemoveUnregisteredRenderComps();
+    }
+
+    void SceneRegistry::DestroySubtree(crsp<Object> root)
+    {
+        ZoneScoped;
+
+        assert(root->parent.expired());
+
+        vecsp<Object> objects;
+        CollectSubtree(root, objects);
+
+        // 倒序遍历时子物体先于父物体，和之前逐个递归Destroy的顺序一致
+        for (auto it = objects.rbegin(); it != objects.rend(); ++it)
+        {
+            for (const auto& comp : (*it)->GetComps())
+            {
+                comp->Destroy();
+            }
+        }
+
+        for (const auto& obj : objects)
+        {
+            for (const auto& comp : obj->GetComps())
+            {
+                m_compStorage.RemoveComp(comp);
+            }
+
+            if (obj->m_registryIndex != INVALID_INDEX)
+            {
+                RemoveObject(obj.get());
+            }
+
+            // 整个层级一起拆开，不需要从父物体的子物体列表里逐个查找移除
+            obj->parent.reset();
+            obj->m_children.clear();
         }
 
-        m_objects.erase(
-            std::remove_if(
-                m_objects.begin(), m_objects.end(),
-                [&obj](crwp<Object> x){ return x.lock() == obj; }),
-            m_objects.end());
+        RemoveUnregisteredRenderComps();
+    }
+
+    void SceneRegistry::Defer(func<void()>&& cmd)
+    {
+        std::lock_guard lock(m_deferredMutex);
+        m_deferredCmds.push_back(std::move(cmd));
+    }
+
+    void SceneRegistry::FlushDeferred()
+    {
+        ZoneScoped;
+
+        assert(Utils::IsMainThread());
+
+        // 执行中再提交的命令也在这次同步点执行完
+        while (true)
+        {
+            {
+                std::lock_guard lock(m_deferredMutex);
+                if (m_deferredCmds.empty())
+                {
+                    return;
+                }
+                m_executingCmds.swap(m_deferredCmds);
+            }
+
+            for (auto& cmd : m_executingCmds)
+            {
+                cmd();
+            }
+            m_executingCmds.clear();
+        }
     }
 
     void SceneRegistry::RegisterComp(crsp<Comp> comp)
@@ -73,7 +262,38 @@ namespace dt
 
     bool SceneRegistry::ObjectExists(crsp<Object> obj)
     {
-        return exists_if(m_objects, [&obj](crwp<Object> x){ return x.lock() == obj;});
+        auto index = obj->m_registryIndex;
+        return index < m_objects.size() && m_objects[index].lock() == obj;
+    }
+
+    void SceneRegistry::RemoveObject(Object* obj)
+    {
+        auto index = obj->m_registryIndex;
+        obj->m_registryIndex = INVALID_INDEX;
+
+        // 用最后一个物体填补空位
+        if (index + 1 != m_objects.size())
+        {
+            m_objects[index] = std::move(m_objects.back());
+            if (auto moved = m_objects[index].lock())
+            {
+                moved->m_registryIndex = index;
+            }
+        }
+        m_objects.pop_back();
+    }
+
+    void SceneRegistry::RemoveUnregisteredRenderComps()
+    {
+        // 批量注销后统一过滤一次，避免每个组件都扫描一遍列表
+        auto isUnregistered = [](crwp<RenderComp> x)
+        {
+            auto comp = x.lock();
+            return !comp || static_cast<Comp*>(comp.get())->m_allIndex == CompStorage::INVALID_INDEX;
+        };
+
+        remove_if(m_opaqueComps, isUnregistered);
+        remove_if(m_transparentComps, isUnregistered);
     }
 
     void SceneRegistry::RegisterRenderComp(crsp<RenderComp> comp)
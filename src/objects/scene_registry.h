@@ -1,4 +1,5 @@
 #pragma once
+#include <mutex>
 #include <typeindex>
 #include <unordered_map>
 
@@ -13,45 +14,105 @@ namespace dt
     class Scene;
     class RenderComp;
 
+    // 每种组件一个连续的指针数组，组件记录自己在数组里的下标，增删都是O(1)，遍历时不需要lock
+    // 组件的所有权仍在Object上，Object::Destroy时会从这里移除
     class CompStorage
     {
-        struct CompsAccessor
-        {
-            std::function<std::any()> createStorageFunc;
-            std::function<bool(const std::weak_ptr<Comp>&, std::any&)> addFunc;
-            std::function<bool(const std::weak_ptr<Comp>&, std::any&)> removeFunc;
-        };
-
-        vecwp<Comp> m_pendingComps;
-        vecwp<Comp> m_allComps;
-        std::unordered_map<std::type_index, std::any> m_comps;
-        static std::unordered_map<std::type_index, CompsAccessor> m_compAccessors;
-        
     public:
+        static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+        static constexpr uint32_t PARALLEL_MIN_COUNT = 64;
+
+        CompStorage() = default;
+        ~CompStorage() = default;
+        CompStorage(const CompStorage& other) = delete;
+        CompStorage(CompStorage&& other) noexcept = delete;
+        CompStorage& operator=(const CompStorage& other) = delete;
+        CompStorage& operator=(CompStorage&& other) noexcept = delete;
+
         void AddComp(const std::shared_ptr<Comp>& comp);
         void RemoveComp(const std::shared_ptr<Comp>& comp);
         template <typename T>
-        const std::vector<std::weak_ptr<T>>& GetComps();
-        crvecwp<Comp> GetAllComps() const { return m_allComps;}
+        const std::vector<T*>& GetComps() const;
+        // ForeachCompPhases执行期间被移除的位置为nullptr
+        const std::vector<Comp*>& GetAllComps() const { return m_allComps; }
         template <typename T>
         static void RegisterComp();
+        template <typename T>
+        static uint32_t GetTypeId();
+
+        // 对遍历开始时的所有组件依次执行每个阶段，所有阶段共用这份快照，阶段中移除的组件不再访问，新加的组件下次才访问
+        // 阶段内按组件加入的顺序执行，PARALLEL_UPDATE的类型在它第一个组件的位置整批执行，数量多时在JobScheduler上并行，期间不能增删组件
+        // 每个阶段结束后调用onPhaseEnd
+        void ForeachCompPhases(std::initializer_list<void (*)(Comp* comp)> phases, const func<void()>& onPhaseEnd);
+
+    private:
+        class ICompPool
+        {
+        public:
+            ICompPool() = default;
+            virtual ~ICompPool() = default;
+            ICompPool(const ICompPool& other) = delete;
+            ICompPool(ICompPool&& other) noexcept = delete;
+            ICompPool& operator=(const ICompPool& other) = delete;
+            ICompPool& operator=(ICompPool&& other) noexcept = delete;
+
+            virtual uint32_t Add(Comp* comp) = 0;
+            virtual uint32_t GetCount() const = 0;
+            virtual Comp* Get(uint32_t index) const = 0;
+            // 用最后一个组件填补空位，返回被移动的组件，没有移动时返回nullptr
+            virtual Comp* Remove(uint32_t index) = 0;
+        };
+
+        template <typename T>
+        class CompPool final : public ICompPool
+        {
+        public:
+            std::vector<T*> comps;
+
+            uint32_t Add(Comp* comp) override;
+            uint32_t GetCount() const override { return static_cast<uint32_t>(comps.size()); }
+            Comp* Get(const uint32_t index) const override { return comps[index]; }
+            Comp* Remove(uint32_t index) override;
+        };
+
+        vecup<ICompPool> m_pools;
+        std::vector<Comp*> m_allComps;
+        uint32_t m_foreachDepth = 0;
+        bool m_hasRemovedDuringForeach = false;
+        bool m_isParallelForeach = false;
+
+        inline static uint32_t s_typeCount = 0;
+        inline static vec<up<ICompPool>(*)()> s_poolCreators;
+        inline static vec<bool> s_parallelTypes;
 
-        template <typename Func>
-        void ForeachPendingComp(Func&& func);
-        template <typename Func>
-        void ForeachAllComp(Func&& func);
+        void ForeachParallelType(uint32_t typeId, uint32_t snapshotCount, void (*func)(Comp* comp));
+        void CompactAllComps();
     };
 
+    // 物体记录自己在m_objects里的下标，注册和注销都是O(1)
     class SceneRegistry
     {
         friend class Object;
         
     public:
+        static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
         explicit SceneRegistry(Scene* scene);
         
+        // 只处理obj自己和它的组件，不包括子物体
         void RegisterObject(crsp<Object> obj);
         void UnregisterObject(crsp<Object> obj);
 
+        // 一次遍历处理整个层级
+        void RegisterSubtree(crsp<Object> root);
+        void UnregisterSubtree(crsp<Object> root);
+        // 销毁root和所有子物体的组件并注销，root需要已经从父物体上移除
+        void DestroySubtree(crsp<Object> root);
+
+        // 可以在任意线程调用，在下一个同步点由主线程按提交顺序执行
+        void Defer(func<void()>&& cmd);
+        void FlushDeferred();
+
         crvecwp<Object> GetAllObjects() const { return m_objects;}
         CompStorage* GetCompStorage() { return &m_compStorage; }
         crvecwp<RenderComp> GetOpaqueRenderComps() const { return m_opaqueComps; }
@@ -65,9 +126,15 @@ namespace dt
         vecwp<RenderComp> m_opaqueComps;
         vecwp<RenderComp> m_transparentComps;
 
+        std::mutex m_deferredMutex;
+        vec<func<void()>> m_deferredCmds;
+        vec<func<void()>> m_executingCmds;
+
         void RegisterComp(crsp<Comp> comp);
         void UnregisterComp(crsp<Comp> comp);
         bool ObjectExists(crsp<Object> obj);
+        void RemoveObject(Object* obj);
+        void RemoveUnregisteredRenderComps();
         void RegisterRenderComp(crsp<RenderComp> comp);
         void UnRegisterRenderComp(crsp<RenderComp> comp);
         vecwp<RenderComp>& GetRenderComps(BlendMode blendMode);
@@ -75,151 +142,138 @@ namespace dt
 
     inline void CompStorage::AddComp(const std::shared_ptr<Comp>& comp)
     {
-        const auto& compTypeIndex = comp->GetType();
-        auto& compAccessor = m_compAccessors.at(compTypeIndex);
+        assert(!m_isParallelForeach);
 
-        auto it = m_comps.find(compTypeIndex);
-        if (it == m_comps.end())
+        if (comp->m_allIndex != INVALID_INDEX)
         {
-            m_comps[compTypeIndex] = compAccessor.createStorageFunc();
-            it = m_comps.find(compTypeIndex);
+            return;
         }
-            
-        if (compAccessor.addFunc(comp, it->second))
+
+        auto typeId = comp->m_typeId;
+        assert(typeId < s_poolCreators.size());
+        if (typeId >= m_pools.size())
         {
-            m_allComps.push_back(comp);
+            m_pools.resize(typeId + 1);
         }
+        if (!m_pools[typeId])
+        {
+            m_pools[typeId] = s_poolCreators[typeId]();
+        }
+
+        comp->m_poolIndex = m_pools[typeId]->Add(comp.get());
+        comp->m_allIndex = static_cast<uint32_t>(m_allComps.size());
+        m_allComps.push_back(comp.get());
     }
 
     inline void CompStorage::RemoveComp(const std::shared_ptr<Comp>& comp)
     {
-        const auto& compTypeIndex = comp->GetType();
-        auto& compAccessor = m_compAccessors.at(compTypeIndex);
+        assert(!m_isParallelForeach);
 
-        auto it = m_comps.find(compTypeIndex);
-        if (it == m_comps.end())
+        if (comp->m_allIndex == INVALID_INDEX)
         {
             return;
         }
-            
-        if (compAccessor.removeFunc(comp, it->second))
+
+        if (auto moved = m_pools[comp->m_typeId]->Remove(comp->m_poolIndex))
         {
-            remove_if(m_pendingComps, [&comp](crwp<Comp> x)
-            {
-                return x.lock() == comp;
-            });
-            
-            remove_if(m_allComps, [&comp](crwp<Comp> x)
-            {
-                return x.lock() == comp;
-            });
+            moved->m_poolIndex = comp->m_poolIndex;
+        }
+        comp->m_poolIndex = INVALID_INDEX;
+
+        auto index = comp->m_allIndex;
+        comp->m_allIndex = INVALID_INDEX;
+        if (m_foreachDepth > 0)
+        {
+            // 遍历中不移动其他组件，结束后再压缩
+            m_allComps[index] = nullptr;
+            m_hasRemovedDuringForeach = true;
+            return;
+        }
+
+        auto last = m_allComps.back();
+        m_allComps.pop_back();
+        if (index < m_allComps.size())
+        {
+            m_allComps[index] = last;
+            last->m_allIndex = index;
         }
     }
 
     template <typename T>
-    const std::vector<std::weak_ptr<T>>& CompStorage::GetComps()
+    const std::vector<T*>& CompStorage::GetComps() const
     {
         static_assert(std::is_base_of_v<Comp, T>);
-            
-        std::type_index compTypeIndex = typeid(T);
 
-        auto it = m_comps.find(compTypeIndex);
-        if (it == m_comps.end())
+        auto typeId = GetTypeId<T>();
+        if (typeId >= m_pools.size() || !m_pools[typeId])
         {
-            static std::vector<std::weak_ptr<T>> empty;
+            static const std::vector<T*> empty;
             return empty;
         }
 
-        return std::any_cast<std::vector<std::weak_ptr<T>>&>(it->second);
+        return static_cast<CompPool<T>*>(m_pools[typeId].get())->comps;
     }
 
     template <typename T>
     void CompStorage::RegisterComp()
     {
         static_assert(std::is_base_of_v<Comp, T>);
-            
-        std::type_index compTypeIndex = typeid(T);
-            
-        CompsAccessor compsAccessor;
 
-        compsAccessor.createStorageFunc = []() -> std::any
+        auto typeId = GetTypeId<T>();
+        if (typeId >= s_poolCreators.size())
         {
-            return std::vector<std::weak_ptr<T>>();
-        };
-        
-        compsAccessor.addFunc = [](const std::weak_ptr<Comp>& comp, std::any& any) -> bool
-        {
-            std::weak_ptr<T> p = std::static_pointer_cast<T>(comp.lock());
-            auto& v = std::any_cast<std::vector<std::weak_ptr<T>>&>(any);
-            auto exists = false;
-            for (auto& w : v)
-            {
-                if (w.lock() == comp.lock())
-                {
-                    exists = true;
-                    break;
-                }
-            }
-
-            if (!exists)
-            {
-                v.push_back(p);
-                return true;
-            }
+            s_poolCreators.resize(typeId + 1);
+            s_parallelTypes.resize(typeId + 1);
+        }
 
-            return false;
-        };
-        
-        compsAccessor.removeFunc = [](const std::weak_ptr<Comp>& comp, std::any& any) -> bool
+        s_poolCreators[typeId] = []() -> up<ICompPool>
         {
-            std::weak_ptr<T> p = std::static_pointer_cast<T>(comp.lock());
-            auto& v = std::any_cast<std::vector<std::weak_ptr<T>>&>(any);
-
-            for (auto i = v.begin(); i != v.end(); ++i)
-            {
-                if (i->lock() == comp.lock())
-                {
-                    v.erase(i);
-                    return true;
-                }
-            }
-
-            return false;
+            return mup<CompPool<T>>();
         };
+        s_parallelTypes[typeId] = T::PARALLEL_UPDATE;
+    }
 
-        m_compAccessors[compTypeIndex] = std::move(compsAccessor);
+    template <typename T>
+    uint32_t CompStorage::GetTypeId()
+    {
+        static const uint32_t typeId = s_typeCount++;
+        return typeId;
     }
 
-    template <typename Func>
-    void CompStorage::ForeachPendingComp(Func&& func)
+    inline void CompStorage::CompactAllComps()
     {
-        static vecwp<Comp> backVec;
-        backVec.clear();
-        
-        for (const auto& comp : m_pendingComps)
+        uint32_t count = 0;
+        for (auto comp : m_allComps)
         {
-            if (func(comp))
-            {
-                m_allComps.push_back(comp);
-            }
-            else
+            if (comp)
             {
-                backVec.push_back(comp);
+                comp->m_allIndex = count;
+                m_allComps[count++] = comp;
             }
         }
 
-        m_pendingComps.swap(backVec);
+        m_allComps.resize(count);
+        m_hasRemovedDuringForeach = false;
     }
 
-    template <typename Func>
-    void CompStorage::ForeachAllComp(Func&& func)
+    template <typename T>
+    uint32_t CompStorage::CompPool<T>::Add(Comp* comp)
     {
-        static vecwp<Comp> curVec;
-        curVec.assign(m_allComps.begin(), m_allComps.end());
-        
-        for (const auto& comp : curVec)
+        comps.push_back(static_cast<T*>(comp));
+        return static_cast<uint32_t>(comps.size() - 1);
+    }
+
+    template <typename T>
+    Comp* CompStorage::CompPool<T>::Remove(const uint32_t index)
+    {
+        auto last = comps.back();
+        comps.pop_back();
+        if (index == comps.size())
         {
-            func(comp);
+            return nullptr;
         }
+
+        comps[index] = last;
+        return last;
     }
 }
@@ -1,12 +1,30 @@
 ﻿#include "transform_comp.h"
 
+#include <tracy/Tracy.hpp>
+
 #include "object.h"
 #include "common/utils.h"
+#include "game/game_resource.h"
+#include "utils/job_scheduler.h"
 
 namespace dt
 {
     using namespace std;
 
+    TransformComp::~TransformComp()
+    {
+        if (m_dirtyIndex != INVALID_INDEX)
+        {
+            s_dirtyLevels[m_dirtyDepth][m_dirtyIndex] = nullptr;
+        }
+
+        // 在matrixChangedEvent回调中被销毁
+        if (m_updatingIndex != INVALID_INDEX)
+        {
+            s_updatingNodes[m_updatingIndex].transform = nullptr;
+        }
+    }
+
     void TransformComp::Awake()
     {
         GetOwner()->transform = this;
@@ -149,98 +167,227 @@ namespace dt
 
     void TransformComp::UpdateAllDirtyComps()
     {
-        for (auto& transform : m_dirtyTransforms)
+        ZoneScoped;
+
+        // 把脏列表按深度拼到s_updatingNodes里，事件回调里新标记的物体留到下一次更新
+        s_updatingNodes.clear();
+        s_updatingLevelEnds.clear();
+        for (auto& level : s_dirtyLevels)
+        {
+            for (auto transform : level)
+            {
+                if (transform)
+                {
+                    transform->m_dirtyIndex = INVALID_INDEX;
+                    transform->m_updatingIndex = static_cast<uint32_t>(s_updatingNodes.size());
+                    s_updatingNodes.push_back({ transform, nullptr });
+                }
+            }
+
+            s_updatingLevelEnds.push_back(static_cast<uint32_t>(s_updatingNodes.size()));
+            level.clear();
+        }
+
+        uint32_t levelStart = 0;
+        for (auto levelEnd : s_updatingLevelEnds)
+        {
+            UpdateLevel(levelStart, levelEnd);
+            levelStart = levelEnd;
+        }
+
+        for (auto& node : s_updatingNodes)
         {
-            transform->UpdateMatrix();
+            if (node.transform)
+            {
+                node.transform->matrixChangedEvent.Invoke();
+            }
         }
 
-        m_dirtyTransforms.clear();
+        for (auto& node : s_updatingNodes)
+        {
+            if (node.transform)
+            {
+                node.transform->m_updatingIndex = INVALID_INDEX;
+            }
+        }
     }
 
-    void TransformComp::UpdateMatrix()
+    void TransformComp::UpdateLevel(const uint32_t start, const uint32_t end)
     {
-        if (!m_dirty)
+        // 去掉已经提前更新过的物体，并取出父物体，并行部分不再访问weak_ptr
+        uint32_t count = 0;
+        for (auto i = start; i < end; ++i)
         {
-            return;
+            auto& node = s_updatingNodes[i];
+            if (!node.transform)
+            {
+                continue;
+            }
+
+            if (!node.transform->m_dirty)
+            {
+                node.transform->m_updatingIndex = INVALID_INDEX;
+                node.transform = nullptr;
+                continue;
+            }
+
+            auto parentObj = node.transform->GetOwner()->parent.lock();
+            auto parent = parentObj ? parentObj->transform : nullptr;
+            if (parent && parent->m_dirty)
+            {
+                // 父物体从创建起还没有更新过，不在脏列表里
+                parent->UpdateMatrix();
+            }
+
+            node.parent = parent;
+            count++;
         }
-        m_dirty = false;
-        
-        XMMATRIX parentLocalToWorld;
-        if (!GetOwner()->parent.expired())
+
+        if (count < PARALLEL_MIN_COUNT || !GR()->jobScheduler)
         {
-            // 如果parent还是dirty的话，GetLocalToWorld会继续往上递归地UpdateMatrix
-            parentLocalToWorld = GetOwner()->parent.lock()->transform->GetLocalToWorld();
-            if (m_position.needUpdateFromWorld)
+            for (auto i = start; i < end; ++i)
             {
-                auto& parentWorldToLocal = GetOwner()->parent.lock()->transform->GetWorldToLocal();
-                m_position.localVal = XMVector3TransformCoord(m_position.worldVal, parentWorldToLocal);
-                m_position.needUpdateFromWorld = false;
+                auto& node = s_updatingNodes[i];
+                if (node.transform)
+                {
+                    node.transform->ComputeMatrix(node.parent);
+                }
             }
+            return;
         }
-        else
+
+        auto job = Job::CreateParallel(end - start, [start](const uint32_t jobStart, const uint32_t jobEnd)
         {
-            parentLocalToWorld = XMMatrixIdentity();
-            if (m_position.needUpdateFromWorld)
+            for (auto i = start + jobStart; i < start + jobEnd; ++i)
             {
-                m_position.localVal = m_position.worldVal;
-                m_position.needUpdateFromWorld = false;
+                auto& node = s_updatingNodes[i];
+                if (node.transform)
+                {
+                    node.transform->ComputeMatrix(node.parent);
+                }
             }
+        });
+        job->SetName("Update Transforms");
+        GR()->jobScheduler->Schedule(job);
+        job->WaitForStop(true);
+    }
+
+    void TransformComp::UpdateMatrix()
+    {
+        if (!m_dirty)
+        {
+            return;
+        }
+
+        // 如果parent还是dirty的话，会继续往上递归地UpdateMatrix
+        auto parentObj = GetOwner()->parent.lock();
+        auto parent = parentObj ? parentObj->transform : nullptr;
+        if (parent)
+        {
+            parent->UpdateMatrix();
         }
 
-        auto objectMatrix = XMMatrixTransformation(
-            XMVectorZero(),
-            XMQuaternionIdentity(),
-            m_scale.localVal,
-            XMVectorZero(),
-            m_rotation.localVal,
-            m_position.localVal);
+        ComputeMatrix(parent);
 
-        m_matrix.localVal = objectMatrix * parentLocalToWorld;
+        matrixChangedEvent.Invoke();
+    }
+
+    void TransformComp::ComputeMatrix(const TransformComp* parent)
+    {
+        m_dirty = false;
 
-        XMVECTOR determinant;
-        m_matrix.worldVal = XMMatrixInverse(&determinant, m_matrix.localVal);
-        auto det = std::abs(XMVectorGetX(determinant));
-        if (det < EPSILON)
+        if (m_position.needUpdateFromWorld)
         {
-            m_matrix.worldVal = XMMatrixInverse(&determinant, {
-                XMVectorSet(EPSILON, 0, 0, 0),
-                XMVectorSet(0, EPSILON, 0, 0),
-                XMVectorSet(0, 0, EPSILON, 0),
-                m_matrix.localVal.r[3]
-            });
+            m_position.localVal = parent ? XMVector3TransformCoord(m_position.worldVal, parent->m_matrix.worldVal) : m_position.worldVal;
+            m_position.needUpdateFromWorld = false;
         }
 
+        auto objectMatrix = ComposeTrs(m_scale.localVal, m_rotation.localVal, m_position.localVal);
+        m_matrix.localVal = parent ? XMMatrixMultiply(objectMatrix, parent->m_matrix.localVal) : objectMatrix;
+
+        float det;
+        m_matrix.worldVal = InverseAffine(m_matrix.localVal, det);
         m_hasOddNegativeScale = det < 0;
 
         m_position.worldVal = m_matrix.localVal.r[3];
+    }
 
-        matrixChangedEvent.Invoke();
+    void TransformComp::OnParentChanged()
+    {
+        // 层级深度变了，不能沿用脏列表里记录的深度
+        uint32_t depth = 0;
+        for (auto parent = GetOwner()->parent.lock(); parent; parent = parent->parent.lock())
+        {
+            depth++;
+        }
+
+        SetDirty(GetOwner(), depth);
+    }
+
+    void TransformComp::AddToDirtyLevel(const uint32_t depth)
+    {
+        if (m_dirtyIndex != INVALID_INDEX)
+        {
+            if (m_dirtyDepth == depth)
+            {
+                return;
+            }
+
+            s_dirtyLevels[m_dirtyDepth][m_dirtyIndex] = nullptr;
+        }
+
+        if (depth >= s_dirtyLevels.size())
+        {
+            s_dirtyLevels.resize(depth + 1);
+        }
+
+        m_dirtyDepth = depth;
+        m_dirtyIndex = static_cast<uint32_t>(s_dirtyLevels[depth].size());
+        s_dirtyLevels[depth].push_back(this);
     }
 
     /// 递归地将当前物体和它的子物体都标记为dirty
     void TransformComp::SetDirty(const Object* object)
     {
-        if (object->transform->m_dirty)
+        auto transform = object->transform;
+        if (!transform)
         {
             return;
         }
-        object->transform->m_dirty = true;
 
-        m_dirtyTransforms.insert(object->transform->shared_from_this());
-    
-        if (object->GetChildren().empty())
+        // 已经在脏列表里时直接用记录的深度，改变父物体时会通过OnParentChanged重新计算
+        auto depth = transform->m_dirtyDepth;
+        if (transform->m_dirtyIndex == INVALID_INDEX)
+        {
+            depth = 0;
+            for (auto parent = object->parent.lock(); parent; parent = parent->parent.lock())
+            {
+                depth++;
+            }
+        }
+
+        SetDirty(object, depth);
+    }
+
+    void TransformComp::SetDirty(const Object* object, const uint32_t depth)
+    {
+        auto transform = object->transform;
+        if (!transform)
         {
             return;
         }
 
-        for (auto& child : object->GetChildren())
+        // 子物体在标记父物体时已经一起标记过了
+        if (transform->m_dirty && transform->m_dirtyIndex != INVALID_INDEX && transform->m_dirtyDepth == depth)
         {
-            if (child->transform->m_dirty)
-            {
-                continue;
-            }
+            return;
+        }
+        transform->m_dirty = true;
+        transform->AddToDirtyLevel(depth);
 
-            SetDirty(child.get());
+        for (auto& child : object->GetChildren())
+        {
+            SetDirty(child.get(), depth + 1);
         }
     }
 }
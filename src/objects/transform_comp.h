@@ -21,8 +21,12 @@ namespace dt
         };
         
     public:
+        static constexpr uint32_t PARALLEL_MIN_COUNT = 256;
+
         Event<> matrixChangedEvent;
 
+        ~TransformComp() override;
+
         void Awake() override;
 
         XMVECTOR GetWorldPosition();
@@ -39,12 +43,15 @@ namespace dt
         bool HasOddNegativeScale();
     
         void UpdateMatrix();
+        // 父物体改变后世界矩阵和层级深度都会变
+        void OnParentChanged();
     
         const XMMATRIX& GetLocalToWorld();
         const XMMATRIX& GetWorldToLocal();
 
         void LoadFromJson(const nlohmann::json& objJson) override;
 
+        // 按层级深度逐层更新，同一层的物体互不依赖，数量多时并行计算，最后在主线程按层级顺序触发matrixChangedEvent
         static void UpdateAllDirtyComps();
 
     private:
@@ -59,8 +66,31 @@ namespace dt
         TransformCompProp<XMVECTOR> m_scale = XMVectorReplicate(1.0f);
         TransformCompProp<XMMATRIX> m_matrix = XMMatrixIdentity();
 
-        inline static uset<sp<TransformComp>> m_dirtyTransforms;
+        static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+        struct UpdatingNode
+        {
+            TransformComp* transform;
+            const TransformComp* parent;
+        };
+
+        // 在s_dirtyLevels中的位置
+        uint32_t m_dirtyDepth = 0;
+        uint32_t m_dirtyIndex = INVALID_INDEX;
+        // 在s_updatingNodes中的位置
+        uint32_t m_updatingIndex = INVALID_INDEX;
+
+        // 标记时按层级深度分开存放，下标为层级深度，析构的物体留下nullptr
+        inline static vec<vec<TransformComp*>> s_dirtyLevels;
+        // 更新时把所有层拼成一个按深度排好序的连续数组，s_updatingLevelEnds[i]为第i层的结束位置
+        inline static vec<UpdatingNode> s_updatingNodes;
+        inline static vec<uint32_t> s_updatingLevelEnds;
+
+        void ComputeMatrix(const TransformComp* parent);
+        void AddToDirtyLevel(uint32_t depth);
 
         static void SetDirty(const Object* object);
+        static void SetDirty(const Object* object, uint32_t depth);
+        static void UpdateLevel(uint32_t start, uint32_t end);
     };
 }
@@ -1,5 +1,7 @@
 #include "batch_mesh.h"
 
+#include <tracy/Tracy.hpp>
+
 #include "common/mesh.h"
 #include "render/descriptor_pool.h"
 #include "render/dx_buffer.h"
@@ -17,6 +19,28 @@ namespace dt
         m_pendingMeshes.push_back(mesh);
     }
 
+    void BatchMesh::UnregisterMesh(crsp<Mesh> mesh)
+    {
+        RegisterMeshActually();
+
+        auto it = m_meshes.find(mesh.get());
+        if (it == m_meshes.end())
+        {
+            THROW_ERROR("Unregistered mesh!")
+        }
+
+        auto& meshInfo = it->second;
+        if (--meshInfo.refCount > 0)
+        {
+            return;
+        }
+
+        m_vertexBuffer->Free(meshInfo.vertexBufferBlockId);
+        m_indexBuffer->Free(meshInfo.indexBufferBlockId);
+
+        m_meshes.erase(it);
+    }
+
     void BatchMesh::BindMesh(ID3D12GraphicsCommandList* cmdList)
     {
         cmdList->IASetIndexBuffer(&m_indexBuffer->GetIndexBufferView());
@@ -27,14 +51,36 @@ namespace dt
     {
         RegisterMeshActually();
 
-        auto meshInfo = find_if(m_meshes, [mesh](cr<MeshInfo> x){ return x.mesh.get() == mesh;});
-        if (!meshInfo)
+        auto it = m_meshes.find(mesh);
+        if (it == m_meshes.end())
         {
             THROW_ERROR("Unregistered mesh!")
         }
 
-        m_vertexBuffer->GetBlock(meshInfo->vertexBufferBlockId, vertexOffsetB, vertexSizeB);
-        m_indexBuffer->GetBlock(meshInfo->indexBufferBlockId, indexOffsetB, indexSizeB);
+        m_vertexBuffer->GetBlock(it->second.vertexBufferBlockId, vertexOffsetB, vertexSizeB);
+        m_indexBuffer->GetBlock(it->second.indexBufferBlockId, indexOffsetB, indexSizeB);
+    }
+
+    void BatchMesh::Defragment()
+    {
+        ZoneScoped;
+
+        // 碎片不多时不整理，避免每帧遍历块和改变布局导致重新计算indirect arg
+        auto needDefragment = [](const DxBuffer* buffer)
+        {
+            return static_cast<float>(buffer->GetFragmentedSizeB()) > static_cast<float>(buffer->GetSizeB()) * DEFRAG_THRESHOLD;
+        };
+        if (!needDefragment(m_vertexBuffer.get()) && !needDefragment(m_indexBuffer.get()))
+        {
+            return;
+        }
+
+        auto vertexMoved = m_vertexBuffer->Defragment(DEFRAG_SIZE_PER_FRAME_B);
+        auto indexMoved = m_indexBuffer->Defragment(DEFRAG_SIZE_PER_FRAME_B);
+        if (vertexMoved || indexMoved)
+        {
+            ++m_layoutVersion;
+        }
     }
 
     void BatchMesh::RegisterMeshActually()
@@ -44,36 +90,38 @@ namespace dt
             return;
         }
 
-        vecsp<Mesh> needAddMeshes;
+        // unordered_map的元素地址在插入后不变，可以先记录再分配空间
+        vec<MeshInfo*> needAddMeshes;
         size_t addVertexDataSizeB = 0;
         size_t addIndexDataSizeB = 0;
         for (auto& mesh : m_pendingMeshes)
         {
-            if (!exists_if(m_meshes, [mesh](cr<MeshInfo> x){ return x.mesh == mesh; }) &&
-                !exists(needAddMeshes, mesh))
+            auto& meshInfo = m_meshes[mesh.get()];
+            if (!meshInfo.mesh)
             {
-                needAddMeshes.push_back(mesh);
+                meshInfo.mesh = mesh;
+                needAddMeshes.push_back(&meshInfo);
                 addVertexDataSizeB += MAX_VERTEX_ATTR_STRIDE_F * mesh->GetVertexCount() * sizeof(float);
                 addIndexDataSizeB += mesh->GetIndicesCount() * sizeof(uint32_t);
             }
+            meshInfo.refCount++;
         }
-        m_pendingMeshes.clear();
 
         m_vertexBuffer->Reserve(m_vertexBuffer->GetSizeB() + addVertexDataSizeB);
         m_indexBuffer->Reserve(m_indexBuffer->GetSizeB() + addIndexDataSizeB);
 
-        for (const auto& mesh : needAddMeshes)
+        for (auto meshInfo : needAddMeshes)
         {
-            auto& vertexData = mesh->GetVertexData();
-            auto& indexData = mesh->GetIndexData();
+            auto& vertexData = meshInfo->mesh->GetVertexData();
+            auto& indexData = meshInfo->mesh->GetIndexData();
 
-            auto vertexBufferId = m_vertexBuffer->Alloc(vertexData.size() * sizeof(float));
-            m_vertexBuffer->Write(vertexBufferId, vertexData.data());
+            meshInfo->vertexBufferBlockId = m_vertexBuffer->Alloc(vertexData.size() * sizeof(float));
+            m_vertexBuffer->Write(meshInfo->vertexBufferBlockId, vertexData.data());
             
-            auto indexBufferId = m_indexBuffer->Alloc(indexData.size() * sizeof(uint32_t));
-            m_indexBuffer->Write(indexBufferId, indexData.data());
-
-            m_meshes.push_back({ mesh, vertexBufferId, indexBufferId });
+            meshInfo->indexBufferBlockId = m_indexBuffer->Alloc(indexData.size() * sizeof(uint32_t));
+            m_indexBuffer->Write(meshInfo->indexBufferBlockId, indexData.data());
         }
+
+        m_pendingMeshes.clear();
     }
 }
@@ -15,11 +15,22 @@ namespace dt
     class BatchMesh
     {
     public:
+        // 每帧整理碎片时最多搬动的数据量
+        static constexpr size_t DEFRAG_SIZE_PER_FRAME_B = 4 * 1024 * 1024;
+        // 空洞超过已用空间的这个比例时才整理碎片
+        static constexpr float DEFRAG_THRESHOLD = 0.25f;
+
         BatchMesh(uint32_t initVertexCount, uint32_t initIndexCount);
 
+        // 网格在buffer里的位置变化时增加，引用这些位置的indirect arg需要重新计算
+        uint32_t GetLayoutVersion() const { return m_layoutVersion; }
+
+        // 按引用计数管理，注册和注销的次数相同时释放网格占用的空间
         void RegisterMesh(crsp<Mesh> mesh);
+        void UnregisterMesh(crsp<Mesh> mesh);
         void BindMesh(ID3D12GraphicsCommandList* cmdList);
         void GetMeshInfo(Mesh* mesh, size_t& vertexOffsetB, size_t& vertexSizeB, size_t& indexOffsetB, size_t& indexSizeB);
+        void Defragment();
 
     private:
         void RegisterMeshActually();
@@ -27,14 +38,17 @@ namespace dt
         struct MeshInfo
         {
             sp<Mesh> mesh;
-            size_t vertexBufferBlockId;
-            size_t indexBufferBlockId;
+            size_t vertexBufferBlockId = 0;
+            size_t indexBufferBlockId = 0;
+            uint32_t refCount = 0;
         };
 
         sp<DxBuffer> m_vertexBuffer;
         sp<DxBuffer> m_indexBuffer;
 
-        vec<MeshInfo> m_meshes;
+        // 用网格地址查找，注册、注销和查询位置都不需要遍历
+        umap<Mesh*, MeshInfo> m_meshes;
         vecsp<Mesh> m_pendingMeshes;
+        uint32_t m_layoutVersion = 0;
     };
 }
@@ -19,6 +19,7 @@ namespace dt
         crsp<BatchMatrixBuffer> batchMatrix)
     {
         m_batchMesh = batchMesh;
+        m_meshLayoutVersion = batchMesh->GetLayoutVersion();
         m_batchMatrix = batchMatrix;
         m_replaceMaterial = replaceMaterial;
 
@@ -59,15 +60,9 @@ namespace dt
         });
         if (!batchRenderSubCmd)
         {
-            size_t vertexOffsetB, vertexSizeB, indexOffsetB, indexSizeB;
-            m_batchMesh->GetMeshInfo(mesh.get(), vertexOffsetB, vertexSizeB, indexOffsetB, indexSizeB);
-            
             BatchRenderSubCmd b;
             b.mesh = mesh;
-            b.indirectArg.drawArg.IndexCountPerInstance = indexSizeB / sizeof(uint32_t);
-            b.indirectArg.drawArg.StartIndexLocation = indexOffsetB / sizeof(uint32_t);
-            b.indirectArg.drawArg.BaseVertexLocation = vertexOffsetB / (MAX_VERTEX_ATTR_STRIDE_F * sizeof(float));
-            b.indirectArg.drawArg.StartInstanceLocation = 0;
+            UpdateDrawArg(b);
             
             batchRenderCmd->subCmds.push_back(b);
             batchRenderSubCmd = &batchRenderCmd->subCmds.back();
@@ -114,6 +109,20 @@ namespace dt
     {
         ZoneScoped;
 
+        // 网格在buffer里被搬动过，重新计算所有的起始位置
+        auto meshLayoutVersion = m_batchMesh->GetLayoutVersion();
+        if (m_meshLayoutVersion != meshLayoutVersion)
+        {
+            for (auto& batchRenderCmd : m_batchRenderCmds)
+            {
+                for (auto& batchRenderSubCmd : batchRenderCmd.subCmds)
+                {
+                    UpdateDrawArg(batchRenderSubCmd);
+                }
+            }
+            m_meshLayoutVersion = meshLayoutVersion;
+        }
+
         auto sumInstanceCount = 0;
         for (auto& batchRenderCmd : m_batchRenderCmds)
         {
@@ -201,6 +210,17 @@ namespace dt
         };
     }
 
+    void BatchRenderGroup::UpdateDrawArg(BatchRenderSubCmd& subCmd) const
+    {
+        size_t vertexOffsetB, vertexSizeB, indexOffsetB, indexSizeB;
+        m_batchMesh->GetMeshInfo(subCmd.mesh.get(), vertexOffsetB, vertexSizeB, indexOffsetB, indexSizeB);
+
+        subCmd.indirectArg.drawArg.IndexCountPerInstance = indexSizeB / sizeof(uint32_t);
+        subCmd.indirectArg.drawArg.StartIndexLocation = indexOffsetB / sizeof(uint32_t);
+        subCmd.indirectArg.drawArg.BaseVertexLocation = vertexOffsetB / (MAX_VERTEX_ATTR_STRIDE_F * sizeof(float));
+        subCmd.indirectArg.drawArg.StartInstanceLocation = 0;
+    }
+
     ComPtr<ID3D12CommandSignature> CmdSigPool::GetCmdSig(crsp<Shader> shader)
     {
         auto pair = find_if(m_commandSignature, [shader](cr<decltype(m_commandSignature)::value_type> a)
@@ -254,12 +274,12 @@ namespace dt
         m_shadowGroup = msp<BatchRenderGroup>(m_shadowMaterial, m_batchMesh, m_batchMatrix);
     }
 
-    void BatchRenderer::Register(crsp<RenderObject> renderObject)
+    void BatchRenderer::Register(crrp<RenderObject> renderObject)
     {
         m_pendingRegisterRenderObjects.push_back(renderObject);
     }
 
-    void BatchRenderer::Unregister(crsp<RenderObject> renderObject)
+    void BatchRenderer::Unregister(crrp<RenderObject> renderObject)
     {
         m_pendingUnregisterRenderObjects.push_back(renderObject);
     }
@@ -273,7 +293,7 @@ namespace dt
         m_shadowGroup->Register(batchRo, m_cmdSigPool);
     }
 
-    void BatchRenderer::UpdateMatrix(crsp<RenderObject> ro)
+    void BatchRenderer::UpdateMatrix(crrp<RenderObject> ro)
     {
         if (!exists(m_dirtyRoMatrix, ro))
         {
@@ -283,6 +303,10 @@ namespace dt
 
     void BatchRenderer::RegisterActually()
     {
+        m_copyingRoMatrix.swap(m_dirtyRoMatrix);
+
+        m_batchMesh->Defragment();
+        
         if (m_pendingRegisterRenderObjects.empty() && m_pendingUnregisterRenderObjects.empty())
         {
             return;
@@ -290,9 +314,9 @@ namespace dt
         
         for (auto& ro : m_pendingRegisterRenderObjects)
         {
-            if (find(m_renderObjects, &BatchRenderObject::ro, ro))
+            if (m_renderObjects.find(ro.Get()) != m_renderObjects.end())
             {
-                return;
+                continue;
             }
 
             m_batchMesh->RegisterMesh(ro->mesh);
@@ -307,21 +331,22 @@ namespace dt
             m_commonGroup->Register(batchRo, m_cmdSigPool);
             m_shadowGroup->Register(batchRo, m_cmdSigPool);
 
-            m_renderObjects.push_back(batchRo);
+            m_renderObjects.emplace(ro.Get(), batchRo);
         }
 
         for (auto& ro : m_pendingUnregisterRenderObjects)
         {
-            auto batchRo = find(m_renderObjects, &BatchRenderObject::ro, ro);
-            if (!batchRo)
+            auto it = m_renderObjects.find(ro.Get());
+            if (it == m_renderObjects.end())
             {
-                return;
+                continue;
             }
             
-            m_commonGroup->Unregister(*batchRo);
-            m_shadowGroup->Unregister(*batchRo);
+            m_commonGroup->Unregister(it->second);
+            m_shadowGroup->Unregister(it->second);
+            m_batchMesh->UnregisterMesh(ro->mesh);
 
-            remove(m_renderObjects, *batchRo);
+            m_renderObjects.erase(it);
         }
         
         m_pendingRegisterRenderObjects.clear();
@@ -330,12 +355,16 @@ namespace dt
         m_cmdSigPool->ClearCmdSig();
     }
 
-    void BatchRenderer::UpdateMatrixActually()
+    void BatchRenderer::CopyDirtyMatrices()
     {
-        for (auto& ro : m_dirtyRoMatrix)
+        ZoneScoped;
+
+        // 只按引用遍历，不增减RenderObject的引用计数
+        for (auto& ro : m_copyingRoMatrix)
         {
-            auto batchRo = find(m_renderObjects, &BatchRenderObject::ro, ro);
-            assert(batchRo);
+            auto it = m_renderObjects.find(ro.Get());
+            assert(it != m_renderObjects.end());
+            auto batchRo = &it->second;
 
             BatchMatrix transposedMatrix;
             transposedMatrix.localToWorld = ro->localToWorld;
@@ -344,11 +373,20 @@ namespace dt
 
             if (batchRo->hasOddNegativeScale != ro->hasOddNegativeScale)
             {
-                batchRo->hasOddNegativeScale = ro->hasOddNegativeScale;
-                ReRegister(*batchRo);
+                m_reRegisterBatchRos.push_back(batchRo);
             }
         }
-        m_dirtyRoMatrix.clear();
+    }
+
+    void BatchRenderer::UploadMatrices()
+    {
+        for (auto batchRo : m_reRegisterBatchRos)
+        {
+            batchRo->hasOddNegativeScale = batchRo->ro->hasOddNegativeScale;
+            ReRegister(*batchRo);
+        }
+        m_reRegisterBatchRos.clear();
+        m_copyingRoMatrix.clear();
 
         m_batchMatrix->RecreateGpuBuffer();
         m_batchMatrix->Upload();
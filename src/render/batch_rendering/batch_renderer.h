@@ -6,6 +6,7 @@
 #include "common/utils.h"
 #include "common/math.h"
 #include "render/cbuffer.h"
+#include "render/render_resources.h"
 #include "render/render_target.h"
 #include "batch_matrix_buffer.h"
 
@@ -21,7 +22,6 @@ namespace dt
     class DxBuffer;
     class ManagedMemoryBlock;
     class ByteBuffer;
-    struct RenderObject;
     class BatchMesh;
     
     struct IndirectArg
@@ -34,7 +34,7 @@ namespace dt
     {
         size_t matrixKey;
         bool hasOddNegativeScale;
-        sp<RenderObject> ro;
+        rp<RenderObject> ro;
 
         friend bool operator==(const BatchRenderObject& lhs, const BatchRenderObject& rhs)
         {
@@ -96,11 +96,14 @@ namespace dt
 
     private:
         sp<BatchMesh> m_batchMesh;
+        uint32_t m_meshLayoutVersion;
         sp<BatchMatrixBuffer> m_batchMatrix;
         sp<DxBuffer> m_batchIndices;
         uint32_t m_batchIndicesBufferIndex;
         sp<Material> m_replaceMaterial;
         vec<BatchRenderCmd> m_batchRenderCmds;
+
+        void UpdateDrawArg(BatchRenderSubCmd& subCmd) const;
     };
 
     class BatchRenderer : public Singleton<BatchRenderer>, public std::enable_shared_from_this<BatchRenderer>
@@ -111,21 +114,26 @@ namespace dt
         BatchRenderGroup* GetCommonRenderGroup() const { return m_commonGroup.get(); }
         BatchRenderGroup* GetShadowRenderGroup() const { return m_shadowGroup.get(); }
 
-        void Register(crsp<RenderObject> renderObject);
-        void Unregister(crsp<RenderObject> renderObject);
+        void Register(crrp<RenderObject> renderObject);
+        void Unregister(crrp<RenderObject> renderObject);
         void ReRegister(cr<BatchRenderObject> batchRo);
         void RegisterActually();
 
-        void UpdateMatrix(crsp<RenderObject> ro);
-        void UpdateMatrixActually();
+        void UpdateMatrix(crrp<RenderObject> ro);
+        // 在job上执行，只把RegisterActually时取出的脏矩阵写到CPU数据，需要重新注册的物体留给UploadMatrices
+        void CopyDirtyMatrices();
+        void UploadMatrices();
 
     private:
 
-        vecsp<RenderObject> m_pendingRegisterRenderObjects;
-        vecsp<RenderObject> m_pendingUnregisterRenderObjects;
-        vecsp<RenderObject> m_dirtyRoMatrix;
+        vecrp<RenderObject> m_pendingRegisterRenderObjects;
+        vecrp<RenderObject> m_pendingUnregisterRenderObjects;
+        vecrp<RenderObject> m_dirtyRoMatrix;
+        // RegisterActually时从m_dirtyRoMatrix交换出来，之后Gui等标记的脏矩阵留到下一帧，和CopyDirtyMatrices互不影响
+        vecrp<RenderObject> m_copyingRoMatrix;
+        vec<BatchRenderObject*> m_reRegisterBatchRos;
         
-        vec<BatchRenderObject> m_renderObjects;
+        umap<RenderObject*, BatchRenderObject> m_renderObjects;
         sp<BatchMesh> m_batchMesh;
         sp<BatchMatrixBuffer> m_batchMatrix;
 
@@ -2,6 +2,7 @@
 
 #include <stdexcept>
 #include <directx/d3dx12_core.h>
+#include <tracy/Tracy.hpp>
 
 #include "directx.h"
 #include "dx_buffer.h"
@@ -38,12 +39,31 @@ namespace dt
             assert(field.logicSizeB <= field.realSizeB);
 
             fields[i] = std::make_pair(field.name.Hash(), std::move(field));
+            fieldIndices[fields[i].first] = i;
         }
     }
 
-    Cbuffer::Cbuffer(sp<CbufferLayout> layout):
-        m_layout(std::move(layout))
+    const CbufferLayout::Field* CbufferLayout::GetField(const string_hash nameId) const
     {
+        auto it = fieldIndices.find(nameId);
+        if (it == fieldIndices.end())
+        {
+            return nullptr;
+        }
+
+        return &fields[it->second].second;
+    }
+
+    Cbuffer::Cbuffer(sp<CbufferLayout> layout, const bool transient):
+        m_layout(std::move(layout)),
+        m_transient(transient)
+    {
+        if (m_transient)
+        {
+            m_transientData.resize(m_layout->desc.Size);
+        }
+
+        // 临时的cbuffer在没有写入过和不再写入时也绑定它
         m_dxBuffer = DxBuffer::Create(m_layout->desc.Size, L"Cbuffer");
     }
 
@@ -52,9 +72,14 @@ namespace dt
         m_dxBuffer.reset();
     }
 
-    ID3D12Resource* Cbuffer::GetDxResource() const
+    D3D12_GPU_VIRTUAL_ADDRESS Cbuffer::GetGpuAddress() const
     {
-        return m_dxBuffer->GetDxResource()->GetResource();
+        if (m_transientGpuAddress != 0)
+        {
+            return m_transientGpuAddress;
+        }
+
+        return m_dxBuffer->GetDxResource()->GetResource()->GetGPUVirtualAddress();
     }
 
     bool Cbuffer::HasField(const string_hash nameId, const ParamType type, const uint32_t repeatCount) const
@@ -70,15 +95,68 @@ namespace dt
     {
         assert(Utils::IsMainThread());
         
-        auto field = find(m_layout->fields, name);
+        auto field = m_layout->GetField(name);
         if (!field)
         {
             return false;
         }
         auto dataSizeB = (std::min)(field->logicSizeB, sizeB);
 
-        m_dxBuffer->Write(field->offsetB, dataSizeB, data);
+        if (m_transient)
+        {
+            memcpy(m_transientData.data() + field->offsetB, data, dataSizeB);
+            if (!m_transientDirty)
+            {
+                m_transientDirty = true;
+                s_dirtyCbuffers.push_back(shared_from_this());
+            }
+        }
+        else
+        {
+            m_dxBuffer->Write(field->offsetB, dataSizeB, data);
+        }
         
         return true;
     }
+
+    void Cbuffer::UploadTransientCbuffers()
+    {
+        ZoneScoped;
+
+        assert(Utils::IsMainThread());
+
+        // 上一帧写入过、这一帧没有写入的，上一帧的上传内存之后会被回收，把数据复制到DxBuffer
+        for (auto& cbuffer : s_lastDirtyCbuffers)
+        {
+            if (!cbuffer->m_transientDirty)
+            {
+                cbuffer->m_dxBuffer->Write(0, cbuffer->m_transientData.size(), cbuffer->m_transientData.data());
+                cbuffer->m_transientGpuAddress = 0;
+            }
+        }
+
+        for (auto& cbuffer : s_dirtyCbuffers)
+        {
+            auto uploadBuffer = DxResource::GetUploadBuffer(
+                cbuffer->m_transientData.data(),
+                cbuffer->m_transientData.size(),
+                D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+
+            cbuffer->m_transientGpuAddress = uploadBuffer.resource->GetResource()->GetGPUVirtualAddress() + uploadBuffer.offsetB;
+            cbuffer->m_transientDirty = false;
+        }
+
+        TracyPlot("Transient Cbuffer Upload Count", static_cast<int64_t>(s_dirtyCbuffers.size()));
+
+        s_lastDirtyCbuffers.swap(s_dirtyCbuffers);
+        s_dirtyCbuffers.clear();
+    }
+
+    void Cbuffer::ReleaseTransientCbuffers()
+    {
+        assert(Utils::IsMainThread());
+
+        s_dirtyCbuffers.clear();
+        s_lastDirtyCbuffers.clear();
+    }
 }
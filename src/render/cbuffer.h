@@ -1,7 +1,6 @@
 ﻿#pragma once
 #include <d3d12.h>
 #include <d3d12shader.h>
-#include <set>
 #include <wrl/client.h>
 
 #include "param_types.h"
@@ -28,16 +27,21 @@ namespace dt
         StringHandle name;
         D3D12_SHADER_BUFFER_DESC desc;
         vecpair<string_hash, Field> fields;
+        umap<string_hash, uint32_t> fieldIndices;
 
         CbufferLayout(ID3D12ShaderReflectionConstantBuffer* cbReflection, cr<D3D12_SHADER_BUFFER_DESC> cbDesc);
 
-        const Field* GetField(const string_hash nameId) { return find(fields, nameId); }
+        const Field* GetField(string_hash nameId) const;
     };
+
+    // 持久的cbuffer有自己的DxBuffer，写入后上传到默认堆
+    // 临时的cbuffer在CPU保存数据，写入的那一帧从上传环里分配一段，直接用上传堆的GPU地址绑定，适用于经常变化的数据
+    // 临时的cbuffer不再写入后，数据复制到自己的DxBuffer一次，之后绑定DxBuffer，不再每帧上传
     
     class Cbuffer : public std::enable_shared_from_this<Cbuffer>
     {
     public:
-        explicit Cbuffer(sp<CbufferLayout> layout);
+        explicit Cbuffer(sp<CbufferLayout> layout, bool transient = false);
         ~Cbuffer();
         Cbuffer(const Cbuffer& other) = delete;
         Cbuffer(Cbuffer&& other) noexcept = delete;
@@ -45,7 +49,8 @@ namespace dt
         Cbuffer& operator=(Cbuffer&& other) noexcept = delete;
 
         sp<CbufferLayout> GetLayout() const { return m_layout; }
-        ID3D12Resource* GetDxResource() const;
+        bool IsTransient() const { return m_transient; }
+        D3D12_GPU_VIRTUAL_ADDRESS GetGpuAddress() const;
         
         bool HasField(string_hash nameId, ParamType type, uint32_t repeatCount) const;
 
@@ -53,18 +58,28 @@ namespace dt
         bool Write(string_hash name, T val);
         bool Write(string_hash name, const void* data, uint32_t sizeB);
         
-        static void UpdateDirtyCbuffers();
+        // 为这一帧写入过的临时cbuffer分配上传内存，在这一帧的写入都完成后、DxBuffer::SubmitDirtyData之前调用
+        static void UploadTransientCbuffers();
+        // 程序结束时在device释放前调用
+        static void ReleaseTransientCbuffers();
 
     private:
-        void ApplyModifies();
-
         StringHandle m_name;
         
         sp<DxBuffer> m_dxBuffer;
 
         sp<CbufferLayout> m_layout;
 
-        inline static std::set<sp<Cbuffer>> s_dirtyCbuffers;
+        bool m_transient;
+        vec<uint8_t> m_transientData;
+        // 为0时绑定m_dxBuffer
+        D3D12_GPU_VIRTUAL_ADDRESS m_transientGpuAddress = 0;
+        // 这一帧写入过，已经在s_dirtyCbuffers里
+        bool m_transientDirty = false;
+
+        // 这一帧和上一帧写入过的临时cbuffer，Write只能在主线程调用，不需要加锁
+        inline static vecsp<Cbuffer> s_dirtyCbuffers;
+        inline static vecsp<Cbuffer> s_lastDirtyCbuffers;
     };
 
     template <typename T>
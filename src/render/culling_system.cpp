@@ -4,7 +4,7 @@
 
 namespace dt
 {
-    CullingSystem::CullingSystem()
+    CullingSystem::CullingSystem() : m_cullData(1024)
     {
     }
     
@@ -29,15 +29,15 @@ namespace dt
             auto i = j * 4;
 
             SimdVec4 center = {
-                _mm_load_ps(m_cullData.centerX.Data() + i),
-                _mm_load_ps(m_cullData.centerY.Data() + i),
-                _mm_load_ps(m_cullData.centerZ.Data() + i),
+                _mm_load_ps(m_cullData.Data<CENTER_X>() + i),
+                _mm_load_ps(m_cullData.Data<CENTER_Y>() + i),
+                _mm_load_ps(m_cullData.Data<CENTER_Z>() + i),
                 XMVectorReplicate(0.0f)
             };
             SimdVec4 extents = {
-                _mm_load_ps(m_cullData.extentsX.Data() + i),
-                _mm_load_ps(m_cullData.extentsY.Data() + i),
-                _mm_load_ps(m_cullData.extentsZ.Data() + i),
+                _mm_load_ps(m_cullData.Data<EXTENTS_X>() + i),
+                _mm_load_ps(m_cullData.Data<EXTENTS_Y>() + i),
+                _mm_load_ps(m_cullData.Data<EXTENTS_Z>() + i),
                 XMVectorReplicate(0.0f)
             };
 
@@ -57,29 +57,7 @@ namespace dt
                 resultP = XMVectorAndInt(resultP, XMVectorOrInt(cmp_d0, cmp_d1));
             }
 
-            _mm_store_ps(m_cullData.visible.Data() + i, resultP);
+            _mm_store_ps(m_cullData.Data<VISIBLE>() + i, resultP);
         }
     }
-
-    CullingSystem::CullData::CullData()
-    {
-        centerX = sl<float>(1024);
-        centerY = sl<float>(1024);
-        centerZ = sl<float>(1024);
-        extentsX = sl<float>(1024);
-        extentsY = sl<float>(1024);
-        extentsZ = sl<float>(1024);
-        visible = sl<float>(1024);
-    }
-
-    void CullingSystem::CullData::Add()
-    {
-        centerX.Add(0);
-        centerY.Add(0);
-        centerZ.Add(0);
-        extentsX.Add(0);
-        extentsY.Add(0);
-        extentsZ.Add(0);
-        visible.Add(1);
-    }
 }
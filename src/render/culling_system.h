@@ -2,6 +2,7 @@
 #include "common/const.h"
 
 #include "common/math.h"
+#include "utils/soa_list.h"
 
 namespace dt
 {
@@ -13,22 +14,19 @@ namespace dt
         void CullingSystem::CullBatch(cr<arr<XMVECTOR, 6>> planes, uint32_t start, uint32_t end);
 
     private:
-        struct CullData
+        enum CullField : uint8_t
         {
-            sl<float> centerX;
-            sl<float> centerY;
-            sl<float> centerZ;
-            sl<float> extentsX;
-            sl<float> extentsY;
-            sl<float> extentsZ;
-
-            sl<float> visible;
-
-            CullData();
-
-            void Add();
+            CENTER_X,
+            CENTER_Y,
+            CENTER_Z,
+            EXTENTS_X,
+            EXTENTS_Y,
+            EXTENTS_Z,
+            VISIBLE,
         };
 
+        using CullData = SoaList<float, float, float, float, float, float, float>;
+
         CullData m_cullData;
     };
 }
@@ -100,19 +100,25 @@ namespace dt
         Dx()->GetDevice()->CreateShaderResourceView(
             dxTexture->GetDxResource()->GetResource(),
             &srvDesc,
-            srvHandle->data.cpuHandle);
+            srvHandle.GetData().cpuHandle);
         
-        auto filterMode = dxTexture->GetDesc().filterMode;
-        auto wrapMode = dxTexture->GetDesc().wrapMode;
-        auto samplerHandle = m_samplerPool.Find([this, filterMode, wrapMode](crsp<SamplerPool::Handle> poolHandle)
-        {
-            return poolHandle->data.filterMode == filterMode && poolHandle->data.wrapMode == wrapMode;
-        });
+        auto descHandle = msp<ShaderResource>();
+        descHandle->m_pool = this;
+        descHandle->m_srvPoolHandle = std::move(srvHandle);
+        descHandle->m_samplerIndex = GetSamplerIndex(dxTexture->GetDesc().filterMode, dxTexture->GetDesc().wrapMode);
+
+        return descHandle;
+    }
+
+    uint32_t DescriptorPool::GetSamplerIndex(const TextureFilterMode filterMode, const TextureWrapMode wrapMode)
+    {
+        auto key = static_cast<uint32_t>(filterMode) << 8 | static_cast<uint32_t>(wrapMode);
+        auto& samplerHandle = m_samplerHandles[key];
         if (!samplerHandle)
         {
-            samplerHandle = m_samplerPool.Alloc();
-            samplerHandle->data.filterMode = filterMode;
-            samplerHandle->data.wrapMode = wrapMode;
+            samplerHandle = m_samplerPool.AllocHandle();
+            samplerHandle.GetData().filterMode = filterMode;
+            samplerHandle.GetData().wrapMode = wrapMode;
             
             D3D12_SAMPLER_DESC samplerDesc = {};
             samplerDesc.Filter = ToD3D12Filter(filterMode);
@@ -126,17 +132,12 @@ namespace dt
 
             CD3DX12_CPU_DESCRIPTOR_HANDLE dxSamplerHandle(
                 m_samplerDescHeap->GetCPUDescriptorHandleForHeapStart(),
-                static_cast<INT>(samplerHandle->GetIndex()),
+                static_cast<INT>(samplerHandle.GetIndex()),
                 m_samplerDescSizeB);
             Dx()->GetDevice()->CreateSampler(&samplerDesc, dxSamplerHandle);
         }
 
-        auto descHandle = msp<ShaderResource>();
-        descHandle->m_pool = this;
-        descHandle->m_srvPoolHandle = srvHandle;
-        descHandle->m_samplerPoolHandle = samplerHandle;
-
-        return descHandle;
+        return samplerHandle.GetIndex();
     }
 
     sp<ShaderResource> DescriptorPool::AllocBufferSrv(const DxResource* dxResource, uint32_t sizeB)
@@ -155,32 +156,31 @@ namespace dt
         Dx()->GetDevice()->CreateShaderResourceView(
             dxResource->GetResource(),
             &srvDesc,
-            srvHandle->data.cpuHandle);
+            srvHandle.GetData().cpuHandle);
 
         auto descHandle = msp<ShaderResource>();
         descHandle->m_pool = this;
-        descHandle->m_srvPoolHandle = srvHandle;
-        descHandle->m_samplerPoolHandle = nullptr;
+        descHandle->m_srvPoolHandle = std::move(srvHandle);
 
         return descHandle;
     }
 
-    sp<SrvPool::Handle> DescriptorPool::AllocEmptySrvHandle()
+    SrvPool::Handle DescriptorPool::AllocEmptySrvHandle()
     {
-        auto srvHandle = m_srvPool.Alloc();
+        auto srvHandle = m_srvPool.AllocHandle();
         CD3DX12_CPU_DESCRIPTOR_HANDLE srvCpuHandle = {
             m_srvDescHeap->GetCPUDescriptorHandleForHeapStart(),
-            static_cast<INT>(srvHandle->GetIndex()),
+            static_cast<INT>(srvHandle.GetIndex()),
             m_srvDescSizeB
         };
         CD3DX12_GPU_DESCRIPTOR_HANDLE srvGpuHandle = {
             m_srvDescHeap->GetGPUDescriptorHandleForHeapStart(),
-            static_cast<INT>(srvHandle->GetIndex()),
+            static_cast<INT>(srvHandle.GetIndex()),
             m_srvDescSizeB
         };
         
-        srvHandle->data.cpuHandle = srvCpuHandle;
-        srvHandle->data.gpuHandle = srvGpuHandle;
+        srvHandle.GetData().cpuHandle = srvCpuHandle;
+        srvHandle.GetData().gpuHandle = srvGpuHandle;
 
         return srvHandle;
     }
@@ -188,8 +188,8 @@ namespace dt
     void DescriptorPool::AllocRtv(
         crvec<DxTexture*> colorAttachments,
         const DxTexture* depthAttachment,
-        vecsp<RtvPool::Handle>& rtvHandles,
-        sp<DsvPool::Handle>& dsvHandle)
+        vec<RtvPool::Handle>& rtvHandles,
+        DsvPool::Handle& dsvHandle)
     {
         assert(colorAttachments.size() > 0 || depthAttachment);
 
@@ -198,10 +198,10 @@ namespace dt
             rtvHandles.resize(colorAttachments.size());
             for (uint32_t i = 0; i < colorAttachments.size(); ++i)
             {
-                auto rtvHandle = m_rtvPool.Alloc(colorAttachments.size() > 1);
+                auto rtvHandle = m_rtvPool.AllocHandle(colorAttachments.size() > 1);
                 CD3DX12_CPU_DESCRIPTOR_HANDLE rtvCpuHandle = {
                     m_rtvDescHeap->GetCPUDescriptorHandleForHeapStart(),
-                    static_cast<INT>(rtvHandle->GetIndex()),
+                    static_cast<INT>(rtvHandle.GetIndex()),
                     m_rtvDescSizeB
                 };
 
@@ -223,17 +223,17 @@ namespace dt
                     colorAttachments[i]->GetDxResource()->GetResource(),
                     &rtvDesc,
                     rtvCpuHandle);
-                rtvHandle->data = rtvCpuHandle;
-                rtvHandles[i] = rtvHandle;
+                rtvHandle.GetData() = rtvCpuHandle;
+                rtvHandles[i] = std::move(rtvHandle);
             }
         }
 
         if (depthAttachment)
         {
-            dsvHandle = m_dsvPool.Alloc();
+            dsvHandle = m_dsvPool.AllocHandle();
             CD3DX12_CPU_DESCRIPTOR_HANDLE dsvCpuHandle = {
                 m_dsvDescHeap->GetCPUDescriptorHandleForHeapStart(),
-                static_cast<INT>(dsvHandle->GetIndex()),
+                static_cast<INT>(dsvHandle.GetIndex()),
                 m_dsvDescSizeB
             };
             
@@ -255,7 +255,7 @@ namespace dt
                 depthAttachment->GetDxResource()->GetResource(),
                 &desc,
                 dsvCpuHandle);
-            dsvHandle->data = dsvCpuHandle;
+            dsvHandle.GetData() = dsvCpuHandle;
         }
     }
 
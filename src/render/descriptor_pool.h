@@ -37,15 +37,16 @@ namespace dt
 
     struct ShaderResource
     {
-        uint32_t GetSrvIndex() const { return m_srvPoolHandle->GetIndex(); }
-        uint32_t GetSamplerIndex() const { return m_samplerPoolHandle->GetIndex(); }
+        uint32_t GetSrvIndex() const { return m_srvPoolHandle.GetIndex(); }
+        uint32_t GetSamplerIndex() const { return m_samplerIndex; }
 
         CD3DX12_CPU_DESCRIPTOR_HANDLE GetSrvCpuHandle();
 
     private:
         DescriptorPool* m_pool;
-        sp<SrvPool::Handle> m_srvPoolHandle;
-        sp<SamplerPool::Handle> m_samplerPoolHandle;
+        SrvPool::Handle m_srvPoolHandle;
+        // sampler由DescriptorPool按过滤和寻址模式共享，只记录下标
+        uint32_t m_samplerIndex = SamplerPool::INVALID_INDEX;
 
         friend class DescriptorPool;
     };
@@ -60,12 +61,12 @@ namespace dt
 
         sp<ShaderResource> AllocTextureSrv(const DxTexture* dxTexture);
         sp<ShaderResource> AllocBufferSrv(const DxResource* dxResource, uint32_t sizeB);
-        sp<SrvPool::Handle> AllocEmptySrvHandle();
+        SrvPool::Handle AllocEmptySrvHandle();
         void AllocRtv(
             crvec<DxTexture*> colorAttachments,
             const DxTexture* depthAttachment,
-            vecsp<RtvPool::Handle>& rtvHandles, sp<DsvPool::
-            Handle>& dsvHandle);
+            vec<RtvPool::Handle>& rtvHandles,
+            DsvPool::Handle& dsvHandle);
         
         void SetHeaps(ID3D12GraphicsCommandList* cmdList);
 
@@ -77,6 +78,8 @@ namespace dt
         SamplerPool m_samplerPool;
         ComPtr<ID3D12DescriptorHeap> m_samplerDescHeap;
         uint32_t m_samplerDescSizeB;
+        // 过滤和寻址模式的组合很少，创建后一直保留，key见GetSamplerIndex
+        umap<uint32_t, SamplerPool::Handle> m_samplerHandles;
 
         RtvPool m_rtvPool;
         ComPtr<ID3D12DescriptorHeap> m_rtvDescHeap;
@@ -85,5 +88,7 @@ namespace dt
         DsvPool m_dsvPool;
         ComPtr<ID3D12DescriptorHeap> m_dsvDescHeap;
         uint32_t m_dsvDescSizeB;
+
+        uint32_t GetSamplerIndex(TextureFilterMode filterMode, TextureWrapMode wrapMode);
     };
 }
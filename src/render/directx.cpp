@@ -13,6 +13,7 @@
 #include <directx/d3dx12_core.h>
 #include <tracy/Tracy.hpp>
 
+#include "cbuffer.h"
 #include "dx_resource.h"
 #include "render_target.h"
 #include "render_thread.h"
@@ -56,6 +57,8 @@ namespace dt
         
         m_swapChainRenderTargets.clear();
         m_swapChainRenderTextures.clear();
+        Cbuffer::ReleaseTransientCbuffers();
+        DxResource::ReleaseUploadBuffers();
 
         delete m_gui;
         delete m_renderThread;
@@ -1,6 +1,7 @@
 ﻿#include "dx_buffer.h"
 
 #include <directx/d3dx12_core.h>
+#include <tracy/Tracy.hpp>
 
 #include "directx.h"
 #include "dx_helper.h"
@@ -25,19 +26,23 @@ namespace dt
         auto result = Create(capacityB, name);
 
         result->m_vertexDataStrideB = strideB;
+        // BaseVertexLocation按顶点计算，块的偏移必须是顶点大小的整数倍
+        result->m_alignmentB = strideB;
 
         return result;
     }
 
     void DxBuffer::SubmitDirtyData()
     {
-        auto& b = m_dirtyBuffers;
+        m_uploadedSizeB = 0;
         for (auto& buffer : m_dirtyBuffers)
         {
             buffer->Submit();
         }
 
         m_dirtyBuffers.clear();
+
+        TracyPlot("DxBuffer Uploaded Size", static_cast<int64_t>(m_uploadedSizeB));
     }
 
     sp<ShaderResource> DxBuffer::GetShaderResource()
@@ -82,6 +87,7 @@ namespace dt
     void DxBuffer::Write(const size_t offsetB, const size_t sizeB, const void* data)
     {
         m_dirtyBuffers.insert(shared_from_this());
+        m_dirtyRanges.Add(offsetB, sizeB);
         memcpy(m_cpuBuffer.data() + offsetB, data, sizeB);
     }
 
@@ -90,6 +96,13 @@ namespace dt
         memcpy(data, m_cpuBuffer.data() + offsetB, sizeB);
     }
 
+    void DxBuffer::Move(const size_t srcOffsetB, const size_t dstOffsetB, const size_t sizeB)
+    {
+        m_dirtyBuffers.insert(shared_from_this());
+        m_dirtyRanges.Add(dstOffsetB, sizeB);
+        memmove(m_cpuBuffer.data() + dstOffsetB, m_cpuBuffer.data() + srcOffsetB, sizeB);
+    }
+
     size_t DxBuffer::GetCapacity() const
     {
         return m_capacityB;
@@ -120,31 +133,55 @@ namespace dt
         m_vertexBufferView = std::nullopt;
         m_indexBufferView = std::nullopt;
         
+        // 新的资源没有任何数据，需要完整上传
         m_dirtyBuffers.insert(shared_from_this());
+        m_dirtyRanges.Clear();
+        m_dirtyRanges.Add(0, capacityB);
     }
 
     void DxBuffer::Submit()
     {
-        auto uploadBuffer = DxResource::GetUploadBuffer(m_cpuBuffer.data(), m_cpuBuffer.size());
+        if (m_dirtyRanges.Empty())
+        {
+            return;
+        }
+
+        // 所有脏区间紧挨着放进同一个上传buffer
+        auto dirtySizeB = m_dirtyRanges.GetSizeB();
+        auto uploadBuffer = DxResource::GetUploadBuffer(nullptr, dirtySizeB);
+        size_t uploadOffsetB = 0;
+        for (auto& range : m_dirtyRanges.GetRanges())
+        {
+            memcpy(uploadBuffer.mappedPtr + uploadOffsetB, m_cpuBuffer.data() + range.offsetB, range.sizeB);
+            uploadOffsetB += range.sizeB;
+        }
+        m_uploadedSizeB += dirtySizeB;
         
-        RT()->AddCmd([self=shared_from_this(), uploadBuffer](ID3D12GraphicsCommandList* cmdList)
+        RT()->AddCmd([dxResource=m_dxResource, ranges=m_dirtyRanges.GetRanges(), uploadBuffer](ID3D12GraphicsCommandList* cmdList)
         {
-            auto preState = self->m_dxResource->GetState();
+            auto preState = dxResource->GetState();
             
             if (preState != D3D12_RESOURCE_STATE_COPY_DEST)
             {
-                DxHelper::AddTransition(self->m_dxResource, D3D12_RESOURCE_STATE_COPY_DEST);
+                DxHelper::AddTransition(dxResource, D3D12_RESOURCE_STATE_COPY_DEST);
                 DxHelper::ApplyTransitions(cmdList);
             }
 
-            cmdList->CopyBufferRegion(self->m_dxResource->GetResource(), 0, uploadBuffer->GetResource(), 0, self->m_capacityB);
+            auto srcOffsetB = uploadBuffer.offsetB;
+            for (auto& range : ranges)
+            {
+                cmdList->CopyBufferRegion(dxResource->GetResource(), range.offsetB, uploadBuffer.resource->GetResource(), srcOffsetB, range.sizeB);
+                srcOffsetB += range.sizeB;
+            }
 
             if (preState != D3D12_RESOURCE_STATE_COPY_DEST)
             {
-                DxHelper::AddTransition(self->m_dxResource, preState);
+                DxHelper::AddTransition(dxResource, preState);
             }
 
             DxHelper::ApplyTransitions(cmdList);
         });
+
+        m_dirtyRanges.Clear();
     }
 }
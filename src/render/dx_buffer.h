@@ -2,6 +2,7 @@
 #include <d3d12.h>
 #include <wrl/client.h>
 
+#include "utils/range_set.h"
 #include "utils/storage.h"
 
 namespace dt
@@ -14,6 +15,9 @@ namespace dt
     class DxBuffer : public Storage<DxBuffer>, public std::enable_shared_from_this<DxBuffer>
     {
     public:
+        // 间隔小于这个值的脏区间合并成一次拷贝
+        static constexpr size_t DIRTY_RANGE_MERGE_GAP_B = 4 * 1024;
+
         using Storage::Write;
         using Storage::Read;
 
@@ -24,6 +28,7 @@ namespace dt
         
         void Write(size_t offsetB, size_t sizeB, const void* data);
         void Read(size_t offsetB, size_t sizeB, void* data);
+        void Move(size_t srcOffsetB, size_t dstOffsetB, size_t sizeB);
         size_t GetCapacity() const;
         void SetCapacity(size_t capacityB);
         void Submit();
@@ -32,6 +37,8 @@ namespace dt
         static sp<DxBuffer> CreateVertexBuffer(size_t capacityB, uint32_t strideB, const wchar_t* name = nullptr);
 
         static void SubmitDirtyData();
+        // 上一次SubmitDirtyData上传的字节数
+        static size_t GetUploadedSizeB() { return m_uploadedSizeB; }
 
     private:
         
@@ -39,6 +46,7 @@ namespace dt
         size_t m_capacityB = 0;
         sp<DxResource> m_dxResource = nullptr;
         vec<uint8_t> m_cpuBuffer;
+        RangeSet m_dirtyRanges = RangeSet(DIRTY_RANGE_MERGE_GAP_B);
 
         sp<ShaderResource> m_shaderResource = nullptr;
         std::optional<D3D12_VERTEX_BUFFER_VIEW> m_vertexBufferView;
@@ -46,5 +54,6 @@ namespace dt
         std::optional<uint32_t> m_vertexDataStrideB;
 
         inline static uset<sp<DxBuffer>> m_dirtyBuffers;
+        inline static size_t m_uploadedSizeB = 0;
     };
 }
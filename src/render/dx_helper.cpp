@@ -78,7 +78,7 @@ namespace dt
 
         if (bindResource)
         {
-            cmdList->SetGraphicsRootConstantBufferView(bindResource->rootParameterIndex, cbuffer->GetDxResource()->GetGPUVirtualAddress());
+            cmdList->SetGraphicsRootConstantBufferView(bindResource->rootParameterIndex, cbuffer->GetGpuAddress());
         }
     }
 
@@ -249,20 +249,20 @@ namespace dt
         {
             for (uint32_t i = 0; i < rtvHandles.size(); ++i)
             {
-                cmdList->ClearRenderTargetView(rtvHandles[i]->data, &renderTarget->GetColorAttachments()[i]->GetClearColor().x, 0, nullptr);
+                cmdList->ClearRenderTargetView(rtvHandles[i].GetData(), &renderTarget->GetColorAttachments()[i]->GetClearColor().x, 0, nullptr);
             }
 
             if (dsvHandle)
             {
-                cmdList->ClearDepthStencilView(dsvHandle->data, D3D12_CLEAR_FLAG_DEPTH, renderTarget->GetDepthAttachment()->GetClearColor().x, 0, 0, nullptr);
+                cmdList->ClearDepthStencilView(dsvHandle.GetData(), D3D12_CLEAR_FLAG_DEPTH, renderTarget->GetDepthAttachment()->GetClearColor().x, 0, 0, nullptr);
             }
         }
 
         cmdList->OMSetRenderTargets(
             rtvHandles.size(),
-            rtvHandles.size() > 0 ? &rtvHandles[0]->data : nullptr,
+            rtvHandles.size() > 0 ? &rtvHandles[0].GetData() : nullptr,
             true,
-            dsvHandle ? &dsvHandle->data : nullptr);
+            dsvHandle ? &dsvHandle.GetData() : nullptr);
 
         SetViewport(cmdList, renderTarget->GetSize().x, renderTarget->GetSize().y);
 
@@ -322,7 +322,7 @@ namespace dt
 
     void DxHelper::RenderScene(
         ID3D12GraphicsCommandList* cmdList,
-        crvecsp<RenderObject> renderObjects,
+        crvecrp<RenderObject> renderObjects,
         crsp<Cbuffer> viewCbuffer,
         crsp<RenderTarget> renderTarget,
         crsp<Material> replaceMaterial)
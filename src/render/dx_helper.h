@@ -41,7 +41,7 @@ namespace dt
         static void PrepareCmdList(ID3D12GraphicsCommandList* cmdList);
 
         static void Blit(ID3D12GraphicsCommandList* cmdList, const Material* material, crsp<RenderTarget> renderTarget);
-        static void RenderScene(ID3D12GraphicsCommandList* cmdList, crvecsp<RenderObject> renderObjects,
+        static void RenderScene(ID3D12GraphicsCommandList* cmdList, crvecrp<RenderObject> renderObjects,
                                 crsp<Cbuffer> viewCbuffer, crsp<RenderTarget> renderTarget, crsp<Material> replaceMaterial);
     };
 }
@@ -2,6 +2,7 @@
 
 #include <directx/d3dx12_core.h>
 #include <directx/d3dx12.h>
+#include <tracy/Tracy.hpp>
 
 #include "directx.h"
 #include "dx_helper.h"
@@ -64,72 +65,87 @@ namespace dt
         return set_recyclable(result);
     }
 
-    sp<DxResource> DxResource::GetUploadBuffer(const void* data, const size_t sizeB)
+    UploadAllocation DxResource::GetUploadBuffer(const void* data, const size_t sizeB, const size_t alignment)
     {
         assert(Utils::IsMainThread());
-        
-        DxResource* result = nullptr;
-        
-        auto it = std::find_if(m_uploadBufferPool.begin(), m_uploadBufferPool.end(), [sizeB](const DxResource* item)
-        {
-            return item->m_desc.Width == sizeB;
-        });
-        if (it != m_uploadBufferPool.end())
+
+        if (!m_uploadRing)
         {
-            result = *it;
-            m_uploadBufferPool.erase(it);
+            // 环一直存在到程序结束，不经过RecycleBin
+            m_uploadRing = sp<DxResource>(CreateUploadBufferRaw(UPLOAD_RING_SIZE_B, L"Upload Ring"));
+            m_uploadRingAllocator = mup<RingAllocator>(UPLOAD_RING_SIZE_B);
         }
 
-        if (!result)
+        UploadAllocation result;
+        auto offsetB = m_uploadRingAllocator->Alloc(sizeB, alignment);
+        if (offsetB != RingAllocator::INVALID_OFFSET)
         {
-            DxResourceDesc desc;
-            desc.heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-            desc.resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(sizeB);
-            desc.initialResourceState = D3D12_RESOURCE_STATE_GENERIC_READ;
-            desc.pOptimizedClearValue = nullptr;
-            desc.heapFlags = D3D12_HEAP_FLAG_NONE;
-            desc.name = L"Upload Buffer";
-            desc.unmanagedResource = nullptr;
-
-            result = CreateRaw(desc);
-            THROW_IF_FAILED(result->GetResource()->Map(0, nullptr, &result->m_mappedPtr));
+            result.resource = m_uploadRing;
+            result.offsetB = offsetB;
         }
-
-        result->m_usedFrameCount = GR()->GetFrameCount();
+        else
+        {
+            // 超过环的大小，或者环被还在执行的帧占满
+            result.resource = set_recyclable(CreateUploadBufferRaw(sizeB, L"Upload Buffer"));
+            result.offsetB = 0;
+        }
+        result.mappedPtr = static_cast<uint8_t*>(result.resource->m_mappedPtr) + result.offsetB;
 
         if (data)
         {
-            memcpy(result->m_mappedPtr, data, sizeB);
+            memcpy(result.mappedPtr, data, sizeB);
         }
 
-        return std::shared_ptr<DxResource>(result, [](DxResource* ptr)
-        {
-            m_uploadBufferPool.push_back(ptr);
-        });
+        return result;
     }
 
-    void DxResource::ClearUploadBuffers() // TODO CALL
+    void DxResource::ReclaimUploadBuffers()
     {
         assert(Utils::IsMainThread());
 
-        vec<DxResource*> toDelete;
-        for (auto& item : m_uploadBufferPool)
+        // 渲染线程已经等待完上一帧的栅栏，上一帧及之前的上传内存都不再使用
+        if (m_uploadRingAllocator && GR()->GetFrameCount() > 0)
         {
-            if (GR()->GetFrameCount() - item->m_usedFrameCount > 10)
-            {
-                toDelete.push_back(item);
-            }
+            m_uploadRingAllocator->Reclaim(GR()->GetFrameCount() - 1);
         }
+    }
 
-        for (auto& item : toDelete)
-        {
-            item->m_resource->Unmap(0, nullptr);
-            delete item;
+    void DxResource::EndUploadFrame()
+    {
+        assert(Utils::IsMainThread());
 
-            remove(m_uploadBufferPool, item);
+        if (m_uploadRingAllocator)
+        {
+            m_uploadRingAllocator->EndFrame(GR()->GetFrameCount());
+            TracyPlot("Upload Ring Used Size", static_cast<int64_t>(m_uploadRingAllocator->GetUsedSizeB()));
         }
     }
 
+    void DxResource::ReleaseUploadBuffers()
+    {
+        assert(Utils::IsMainThread());
+
+        m_uploadRingAllocator.reset();
+        m_uploadRing.reset();
+    }
+
+    DxResource* DxResource::CreateUploadBufferRaw(const size_t sizeB, const wchar_t* name)
+    {
+        DxResourceDesc desc;
+        desc.heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+        desc.resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(sizeB);
+        desc.initialResourceState = D3D12_RESOURCE_STATE_GENERIC_READ;
+        desc.pOptimizedClearValue = nullptr;
+        desc.heapFlags = D3D12_HEAP_FLAG_NONE;
+        desc.name = name;
+        desc.unmanagedResource = nullptr;
+
+        auto result = CreateRaw(desc);
+        THROW_IF_FAILED(result->GetResource()->Map(0, nullptr, &result->m_mappedPtr));
+
+        return result;
+    }
+
     DxResource* DxResource::CreateRaw(DxResourceDesc desc)
     {
         if (desc.unmanagedResource)
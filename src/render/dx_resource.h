@@ -4,6 +4,7 @@
 
 #include "common/const.h"
 #include "utils/recycle_bin.h"
+#include "utils/ring_allocator.h"
 
 namespace dt
 {
@@ -20,9 +21,22 @@ namespace dt
         ComPtr<ID3D12Resource> unmanagedResource = nullptr;
     };
     
+    class DxResource;
+
+    // 上传内存中的一段，resource在offsetB处开始的sizeB字节映射在mappedPtr
+    struct UploadAllocation
+    {
+        sp<DxResource> resource;
+        size_t offsetB;
+        uint8_t* mappedPtr;
+    };
+    
     class DxResource : public std::enable_shared_from_this<DxResource>, public IRecyclable
     {
     public:
+        static constexpr size_t UPLOAD_RING_SIZE_B = 64 * 1024 * 1024;
+        static constexpr size_t UPLOAD_ALIGNMENT = 16;
+
         DxResource() = default;
         ~DxResource() override = default;
         DxResource(const DxResource& other) = delete;
@@ -37,8 +51,14 @@ namespace dt
         void CopyTo(crsp<DxResource> dstBuffer, size_t dstOffset, size_t sizeB);
         
         static sp<DxResource> Create(cr<DxResourceDesc> desc);
-        static sp<DxResource> GetUploadBuffer(const void* data, size_t sizeB);
-        static void ClearUploadBuffers();
+        // 从每帧共用的上传环里分配，只在当前帧的命令里使用，放不下时单独创建一个上传buffer
+        static UploadAllocation GetUploadBuffer(const void* data, size_t sizeB, size_t alignment = UPLOAD_ALIGNMENT);
+        // 在渲染线程执行完上一帧的命令后调用
+        static void ReclaimUploadBuffers();
+        // 在当前帧的命令都提交给渲染线程后调用
+        static void EndUploadFrame();
+        // 程序结束时在GPU空闲后、device释放前调用
+        static void ReleaseUploadBuffers();
 
     private:
         static DxResource* CreateRaw(DxResourceDesc desc);
@@ -49,10 +69,12 @@ namespace dt
         D3D12_HEAP_PROPERTIES m_heapProperties;
 
         // for upload buffer only
-        uint32_t m_usedFrameCount = 0;
         void* m_mappedPtr = nullptr;
 
-        inline static vec<DxResource*> m_uploadBufferPool;
+        inline static sp<DxResource> m_uploadRing;
+        inline static up<RingAllocator> m_uploadRingAllocator;
+
+        static DxResource* CreateUploadBufferRaw(size_t sizeB, const wchar_t* name);
 
         friend class DxHelper;
     };
@@ -32,7 +32,7 @@ namespace dt
 
         m_drawShadowMtl = Material::CreateFromShader("shaders/draw_shadow.shader", {});
 
-        m_shadowViewCbuffer = msp<Cbuffer>(GR()->GetPredefinedCbuffer(PER_VIEW_CBUFFER)->GetLayout());
+        m_shadowViewCbuffer = msp<Cbuffer>(GR()->GetPredefinedCbuffer(PER_VIEW_CBUFFER)->GetLayout(), true);
     }
 
     void MainLightShadowPass::PrepareContext(RenderResources* context)
@@ -44,7 +44,7 @@ namespace dt
             RenderRes()->shadowRange,
             m_shadowmapRt->GetSize().x);
         // context->shadowVp = CameraComp::GetMainCamera()->CreateShadowVPMatrix(
-        //     GR()->mainScene->GetRegistry()->GetCompStorage()->GetComps<TestComp>()[0].lock()->GetOwner()->transform->GetLocalToWorld(),
+        //     GR()->mainScene->GetRegistry()->GetCompStorage()->GetComps<TestComp>()[0]->GetOwner()->transform->GetLocalToWorld(),
         //     45, 1.0f, 10.0f,
         //     RenderRes()->mainLightDir,
         //     static_cast<float>(RenderRes()->screenSize.x) / static_cast<float>(RenderRes()->screenSize.y),
@@ -20,14 +20,54 @@
 #include "render/render_resources.h"
 #include "render/render_thread.h"
 #include "render/batch_rendering/batch_renderer.h"
+#include "utils/frame_arena.h"
+#include "utils/system_scheduler.h"
 
 namespace dt
 {
     PreparePass::PreparePass()
     {
-        m_mainCameraViewCbuffer = msp<Cbuffer>(GR()->GetPredefinedCbuffer(PER_VIEW_CBUFFER)->GetLayout());
+        m_mainCameraViewCbuffer = msp<Cbuffer>(GR()->GetPredefinedCbuffer(PER_VIEW_CBUFFER)->GetLayout(), true);
+
+        // 依赖由读写的数据推导，主线程系统按注册顺序执行
+        // 合批注册放在Gui之前，矩阵复制可以和Gui并行，Gui里新建或修改的RenderObject在下一帧注册和更新矩阵
+        m_systemScheduler = mup<SystemScheduler>();
+        // 脏标记回调会更新RenderObject和逐物体cbuffer，并把矩阵加入BatchRenderer的更新队列
+        m_systemScheduler->AddSystem("Update Transforms",
+            {},
+            { SystemData::TRANSFORM, SystemData::RENDER_OBJECT, SystemData::BATCH_QUEUE, SystemData::CBUFFER },
+            [] { TransformComp::UpdateAllDirtyComps(); },
+            true);
+        // 按帧号交换回收站的桶并提交后台删除
+        m_systemScheduler->AddSystem("Flush Recycle Bin",
+            { SystemData::FRAME_INFO },
+            { SystemData::RECYCLE_BIN, SystemData::BACKGROUND_TASK },
+            [] { RecycleBin::Ins()->Flush(); });
+        // 创建和上传dx buffer，只能在主线程执行，同时取出这一帧要复制的脏矩阵
+        m_systemScheduler->AddSystem("Register Batch Objects",
+            { SystemData::RENDER_OBJECT },
+            { SystemData::BATCH, SystemData::BATCH_QUEUE, SystemData::BATCH_MATRIX, SystemData::RESOURCE },
+            [] { BatchRenderer::Ins()->RegisterActually(); },
+            true);
+        m_systemScheduler->AddSystem("Copy Batch Matrices",
+            { SystemData::RENDER_OBJECT },
+            { SystemData::BATCH_MATRIX },
+            [] { BatchRenderer::Ins()->CopyDirtyMatrices(); });
+        // 层级面板会修改Transform，修改RenderComp时会新建RenderObject并加入合批队列；ImGui的输入由主线程的窗口消息写入，只能在主线程执行
+        m_systemScheduler->AddSystem("Gui",
+            { SystemData::FRAME_INFO },
+            { SystemData::GUI, SystemData::TRANSFORM, SystemData::BATCH_QUEUE },
+            [] { Gui::Ins()->Render(); },
+            true);
+        m_systemScheduler->AddSystem("Upload Batch Matrices",
+            {},
+            { SystemData::BATCH, SystemData::BATCH_MATRIX, SystemData::CBUFFER, SystemData::RESOURCE },
+            [] { BatchRenderer::Ins()->UploadMatrices(); },
+            true);
     }
 
+    PreparePass::~PreparePass() = default;
+
     void PreparePass::PrepareContext(RenderResources* context)
     {
         RenderRes()->screenSize = { Window::Ins()->GetWidth(), Window::Ins()->GetHeight() };
@@ -53,14 +93,7 @@ namespace dt
 
     void PreparePass::ExecuteMainThread()
     {
-        TransformComp::UpdateAllDirtyComps();
-
-        RecycleBin::Ins()->Flush();
-
-        Gui::Ins()->Render();
-        
-        BatchRenderer::Ins()->RegisterActually();
-        BatchRenderer::Ins()->UpdateMatrixActually();
+        m_systemScheduler->Execute(GR()->jobScheduler);
     }
 
     func<void(ID3D12GraphicsCommandList*)> PreparePass::ExecuteRenderThread()
@@ -84,28 +117,26 @@ namespace dt
 
         auto& lightComps = GR()->mainScene->GetRegistry()->GetCompStorage()->GetComps<LightComp>();
         
-        auto mainLightCompWp = find_if(lightComps, [](crwp<LightComp> comp)
+        auto lightComp = find_if(lightComps, [](const LightComp* comp)
         {
-            return comp.lock() && comp.lock()->lightType == 0;
+            return comp->lightType == 0;
         });
-        if (mainLightCompWp)
+        if (lightComp)
         {
-            auto lightComp = mainLightCompWp->lock();
             lightDir = Store3(-GetForward(lightComp->GetOwner()->transform->GetLocalToWorld()));
             lightColor = lightComp->GetColor();
         }
 
         uint32_t pointLightCount = 0;
-        vec<XMFLOAT4> pointLightInfos;
-        for (auto& compWp : lightComps)
+        frame_vec<XMFLOAT4> pointLightInfos;
+        pointLightInfos.reserve(MAX_POINT_LIGHT_COUNT * 2);
+        for (auto pointLightComp : lightComps)
         {
-            if (pointLightCount >= MAX_POINT_LIGHT_COUNT || !compWp.lock() || compWp.lock()->lightType != 1)
+            if (pointLightCount >= MAX_POINT_LIGHT_COUNT || pointLightComp->lightType != 1)
             {
                 continue;
             }
             
-            auto pointLightComp = compWp.lock();
-            
             auto positionWS = Store3(pointLightComp->GetOwner()->transform->GetWorldPosition());
             auto radius = pointLightComp->radius;
             auto color = pointLightComp->GetColor();
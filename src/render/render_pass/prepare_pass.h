@@ -6,11 +6,13 @@
 namespace dt
 {
     class Cbuffer;
+    class SystemScheduler;
 
     class PreparePass final : public IRenderPass
     {
     public:
         PreparePass();
+        ~PreparePass() override;
         
         const char* GetName() override { return "Prepare Pass"; }
         void PrepareContext(RenderResources* context) override;
@@ -21,5 +23,6 @@ namespace dt
         void PrepareLights();
         
         sp<Cbuffer> m_mainCameraViewCbuffer = nullptr;
+        up<SystemScheduler> m_systemScheduler;
     };
 }
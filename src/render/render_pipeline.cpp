@@ -50,7 +50,7 @@ namespace dt
         RenderThread::Ins()->Wait();
         RenderThread::Ins()->ReleaseCmdResources();
 
-        DxResource::ClearUploadBuffers();
+        DxResource::ReclaimUploadBuffers();
         
         *RenderRes() = RenderResources();
 
@@ -78,6 +78,8 @@ namespace dt
 
         {
             ZoneScopedN("Submit Dirty Data");
+            // 不再写入的临时cbuffer会写入自己的DxBuffer，需要先于DxBuffer提交
+            Cbuffer::UploadTransientCbuffers();
             DxBuffer::SubmitDirtyData();
         }
 
@@ -101,5 +103,7 @@ namespace dt
             ZoneScopedN("Dispatch Cmds");
             RenderThread::Ins()->ExecuteCmds();
         }
+
+        DxResource::EndUploadFrame();
     }
 }
@@ -4,6 +4,7 @@
 #include "render_context.h"
 #include "common/const.h"
 #include "common/utils.h"
+#include "utils/ref_ptr.h"
 
 namespace dt
 {
@@ -15,7 +16,8 @@ namespace dt
     class Material;
     class Shader;
 
-    struct RenderObject
+    // 只在主线程创建和持有，渲染线程只读
+    struct RenderObject : RefCounted
     {
         sp<Shader> shader;
         sp<Material> material;
@@ -38,7 +40,7 @@ namespace dt
         sp<ViewProjInfo> mainCameraVp = nullptr;
         sp<ViewProjInfo> shadowVp = nullptr;
         sp<Cbuffer> mainCameraViewCbuffer = nullptr;
-        vecsp<RenderObject> renderObjects;
+        vecrp<RenderObject> renderObjects;
         sp<RenderTexture> litResultRt = nullptr;
         sp<RenderTexture> shadowmapRt = nullptr;
         XMFLOAT3 mainLightDir = { 1.0f, 1.0f, 1.0f };
@@ -35,8 +35,8 @@ namespace dt
         }
 
         // Allocate rtv
-        vecsp<RtvPool::Handle> rtvHandles;
-        sp<DsvPool::Handle> dsvHandle = nullptr;
+        vec<RtvPool::Handle> rtvHandles;
+        DsvPool::Handle dsvHandle;
         DescriptorPool::Ins()->AllocRtv(tempColorAttachments, tempDepthAttachment, rtvHandles, dsvHandle);
 
         // Calculate size
@@ -55,8 +55,8 @@ namespace dt
         auto result = msp<RenderTarget>();
         result->m_colorAttachments = colorAttachments;
         result->m_depthAttachment = depthAttachment;
-        result->m_rtvHandles = rtvHandles;
-        result->m_dsvHandle = dsvHandle;
+        result->m_rtvHandles = std::move(rtvHandles);
+        result->m_dsvHandle = std::move(dsvHandle);
         result->m_size = size;
 
         return result;
@@ -10,8 +10,8 @@ namespace dt
     class RenderTarget
     {
     public:
-        crvecsp<RtvPool::Handle> GetRtvHandles() const { return m_rtvHandles; }
-        crsp<DsvPool::Handle> GetDsvHandle() const { return m_dsvHandle; }
+        crvec<RtvPool::Handle> GetRtvHandles() const { return m_rtvHandles; }
+        cr<DsvPool::Handle> GetDsvHandle() const { return m_dsvHandle; }
         crvecsp<RenderTexture> GetColorAttachments() const { return m_colorAttachments; }
         crsp<RenderTexture> GetDepthAttachment() const { return m_depthAttachment; }
         cr<XMINT2> GetSize() const { return m_size; }
@@ -22,8 +22,8 @@ namespace dt
     private:
         vecsp<RenderTexture> m_colorAttachments;
         sp<RenderTexture> m_depthAttachment;
-        vecsp<RtvPool::Handle> m_rtvHandles;
-        sp<DsvPool::Handle> m_dsvHandle;
+        vec<RtvPool::Handle> m_rtvHandles;
+        DsvPool::Handle m_dsvHandle;
         XMINT2 m_size = {0, 0};
     };
 }
@@ -10,7 +10,7 @@ namespace dt
 {
     RenderThread::RenderThread(const char* name)
     {
-        m_thread = mup<ConsumerThread<RenderCmd>>([this](cr<RenderCmd> cmd) { if (cmd) cmd(m_cmdList.Get()); }, name);
+        m_thread = mup<ConsumerThread<RenderCmd>>([this](cr<RenderCmd> cmd) { if (cmd) cmd(m_cmdList.Get()); }, name, CMD_QUEUE_CAPACITY);
         m_thread->Enqueue([this](const ID3D12GraphicsCommandList*) { ThreadInit(); });
     }
 
@@ -38,13 +38,15 @@ namespace dt
     void RenderThread::ReleaseCmdResources()
     {
         m_cmds.clear();
+        m_handOffs.clear();
     }
 
     void RenderThread::ExecuteCmds()
     {
+        m_thread->EnqueueBatch(m_pendingCmds.data(), static_cast<uint32_t>(m_pendingCmds.size()));
+        
         for (auto& cmd : m_pendingCmds)
         {
-            m_thread->Enqueue(cmd);
             m_cmds.push_back(std::move(cmd));
         }
         m_pendingCmds.clear();
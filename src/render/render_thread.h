@@ -8,6 +8,7 @@
 #include "common/utils.h"
 #include "game/game_resource.h"
 #include "utils/consumer_thread.h"
+#include "utils/ref_ptr.h"
 
 namespace dt
 {
@@ -32,6 +33,9 @@ namespace dt
         void Wait() { m_thread->Wait(); }
 
         void AddCmd(RenderCmd&& cmd);
+        // 渲染命令会在渲染线程析构，不能捕获RefPtr；由主线程持有到这一帧的命令执行完，命令里捕获返回的裸指针
+        template <typename T>
+        T* HandOff(crrp<T> ptr);
 
         void ExecuteCmds();
 
@@ -39,6 +43,8 @@ namespace dt
         void ReleaseCmdResources();
 
     private:
+        static constexpr uint32_t CMD_QUEUE_CAPACITY = 1024;
+
         void ThreadInit();
         void ThreadRelease();
 
@@ -48,10 +54,20 @@ namespace dt
         up<ConsumerThread<RenderCmd>> m_thread;
         vec<RenderCmd> m_pendingCmds;
         vec<RenderCmd> m_cmds;
+        vecrp<RefCounted> m_handOffs;
 
         bool m_first = true;
     };
 
+    template <typename T>
+    T* RenderThread::HandOff(crrp<T> ptr)
+    {
+        assert(Utils::IsMainThread());
+
+        m_handOffs.push_back(ptr);
+        return ptr.Get();
+    }
+
     static RenderThread* RT()
     {
         return RenderThread::Ins();
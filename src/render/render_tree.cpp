@@ -7,13 +7,13 @@
 
 namespace dt
 {
-    void RenderTree::Register(crsp<RenderObject> renderObject)
+    void RenderTree::Register(crrp<RenderObject> renderObject)
     {
         assert(!ExistsRenderObject(renderObject));
         
         m_renderObjects.push_back(renderObject);
 
-        std::sort(m_renderObjects.begin(), m_renderObjects.end(), [](crsp<RenderObject> a, crsp<RenderObject> b)
+        std::sort(m_renderObjects.begin(), m_renderObjects.end(), [](crrp<RenderObject> a, crrp<RenderObject> b)
         {
             if (a->shader == b->shader)
             {
@@ -31,15 +31,15 @@ namespace dt
         });
     }
 
-    void RenderTree::UnRegister(crsp<RenderObject> renderObject)
+    void RenderTree::UnRegister(crrp<RenderObject> renderObject)
     {
         assert(ExistsRenderObject(renderObject));
 
         remove(m_renderObjects, renderObject);
     }
 
-    bool RenderTree::ExistsRenderObject(crsp<RenderObject> renderObject)
+    bool RenderTree::ExistsRenderObject(crrp<RenderObject> renderObject)
     {
-        return exists_if(m_renderObjects, [&renderObject](crsp<RenderObject> x){ return x == renderObject; });
+        return exists_if(m_renderObjects, [&renderObject](crrp<RenderObject> x){ return x == renderObject; });
     }
 }
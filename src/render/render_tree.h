@@ -1,10 +1,10 @@
 ﻿#pragma once
 
 #include "common/const.h"
+#include "render_resources.h"
 
 namespace dt
 {
-    struct RenderObject;
     class RenderComp;
     class Mesh;
     class Material;
@@ -13,14 +13,14 @@ namespace dt
     class RenderTree
     {
     public:
-        void Register(crsp<RenderObject> renderObject);
-        void UnRegister(crsp<RenderObject> renderObject);
+        void Register(crrp<RenderObject> renderObject);
+        void UnRegister(crrp<RenderObject> renderObject);
 
-        crvecsp<RenderObject> GetRenderObjects() const { return m_renderObjects; }
+        crvecrp<RenderObject> GetRenderObjects() const { return m_renderObjects; }
 
     private:
-        bool ExistsRenderObject(crsp<RenderObject> renderObject);
+        bool ExistsRenderObject(crrp<RenderObject> renderObject);
         
-        vecsp<RenderObject> m_renderObjects;
+        vecrp<RenderObject> m_renderObjects;
     };
 }
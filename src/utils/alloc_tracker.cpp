@@ -0,0 +1,175 @@
+#include "alloc_tracker.h"
+
+#include <cstdlib>
+#include <new>
+#include <tracy/Tracy.hpp>
+
+#include "common/utils.h"
+
+namespace dt
+{
+    AllocTracker::ThreadCounter AllocTracker::s_counters[ALLOC_TRACKER_MAX_THREAD_COUNT];
+    std::atomic<uint32_t> AllocTracker::s_counterCount = 0;
+    thread_local AllocTracker::ThreadCounter* AllocTracker::s_threadCounter = nullptr;
+
+    AllocTracker::Stats AllocTracker::s_totalStats;
+    AllocTracker::Stats AllocTracker::s_frameStats;
+    uint64_t AllocTracker::s_frameIndex = 0;
+
+    void AllocTracker::BeginFrame()
+    {
+        if constexpr (!ENABLED)
+        {
+            return;
+        }
+
+        Stats total;
+        auto count = (std::min)(s_counterCount.load(std::memory_order_relaxed), static_cast<uint32_t>(ALLOC_TRACKER_MAX_THREAD_COUNT));
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            total.allocCount += s_counters[i].allocCount.load(std::memory_order_relaxed);
+            total.allocSizeB += s_counters[i].allocSizeB.load(std::memory_order_relaxed);
+            total.freeCount += s_counters[i].freeCount.load(std::memory_order_relaxed);
+        }
+
+        // 渲染线程和worker可能跨帧执行，它们的分配算在结算时所在的帧
+        s_frameStats.allocCount = total.allocCount - s_totalStats.allocCount;
+        s_frameStats.allocSizeB = total.allocSizeB - s_totalStats.allocSizeB;
+        s_frameStats.freeCount = total.freeCount - s_totalStats.freeCount;
+        s_totalStats = total;
+
+        TracyPlot("Frame Alloc Count", static_cast<int64_t>(s_frameStats.allocCount));
+        TracyPlot("Frame Alloc Size", static_cast<int64_t>(s_frameStats.allocSizeB));
+
+#ifdef DT_ALLOC_ASSERT
+        if (s_frameIndex >= ALLOC_ASSERT_WARMUP_FRAMES && s_frameStats.allocCount > 0)
+        {
+            THROW_ERRORF("Steady state frame %llu allocated %llu times (%llu bytes)",
+                static_cast<unsigned long long>(s_frameIndex),
+                static_cast<unsigned long long>(s_frameStats.allocCount),
+                static_cast<unsigned long long>(s_frameStats.allocSizeB))
+        }
+#endif
+
+        s_frameIndex++;
+    }
+
+    AllocTracker::Stats AllocTracker::GetThreadStats()
+    {
+        auto counter = GetThreadCounter();
+
+        Stats stats;
+        stats.allocCount = counter->allocCount.load(std::memory_order_relaxed);
+        stats.allocSizeB = counter->allocSizeB.load(std::memory_order_relaxed);
+        stats.freeCount = counter->freeCount.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    void AllocTracker::OnAlloc(const size_t sizeB)
+    {
+        auto counter = GetThreadCounter();
+        counter->allocCount.fetch_add(1, std::memory_order_relaxed);
+        counter->allocSizeB.fetch_add(sizeB, std::memory_order_relaxed);
+    }
+
+    void AllocTracker::OnFree()
+    {
+        GetThreadCounter()->freeCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    AllocTracker::ThreadCounter* AllocTracker::GetThreadCounter()
+    {
+        if (!s_threadCounter)
+        {
+            auto index = s_counterCount.fetch_add(1, std::memory_order_relaxed);
+            s_threadCounter = &s_counters[(std::min)(index, static_cast<uint32_t>(ALLOC_TRACKER_MAX_THREAD_COUNT - 1))];
+        }
+
+        return s_threadCounter;
+    }
+}
+
+#ifdef DT_ALLOC_TRACKING
+
+namespace
+{
+    void* TrackedAlloc(const size_t sizeB, const size_t alignment, const bool throwOnFailure)
+    {
+        // 和标准库一样，0字节也要返回不同的地址
+        auto realSizeB = sizeB > 0 ? sizeB : 1;
+
+        void* ptr;
+#ifdef _WIN32
+        ptr = alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__ ? _aligned_malloc(realSizeB, alignment) : std::malloc(realSizeB);
+#else
+        if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+        {
+            if (posix_memalign(&ptr, alignment, realSizeB) != 0)
+            {
+                ptr = nullptr;
+            }
+        }
+        else
+        {
+            ptr = std::malloc(realSizeB);
+        }
+#endif
+
+        if (!ptr)
+        {
+            if (throwOnFailure)
+            {
+                throw std::bad_alloc();
+            }
+            return nullptr;
+        }
+
+        dt::AllocTracker::OnAlloc(realSizeB);
+        TracyAlloc(ptr, realSizeB);
+        return ptr;
+    }
+
+    void TrackedFree(void* ptr, const size_t alignment)
+    {
+        if (!ptr)
+        {
+            return;
+        }
+
+        dt::AllocTracker::OnFree();
+        TracyFree(ptr);
+
+#ifdef _WIN32
+        if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+        {
+            _aligned_free(ptr);
+            return;
+        }
+#endif
+        std::free(ptr);
+    }
+}
+
+void* operator new(const size_t sizeB) { return TrackedAlloc(sizeB, __STDCPP_DEFAULT_NEW_ALIGNMENT__, true); }
+void* operator new[](const size_t sizeB) { return TrackedAlloc(sizeB, __STDCPP_DEFAULT_NEW_ALIGNMENT__, true); }
+void* operator new(const size_t sizeB, const std::nothrow_t&) noexcept { return TrackedAlloc(sizeB, __STDCPP_DEFAULT_NEW_ALIGNMENT__, false); }
+void* operator new[](const size_t sizeB, const std::nothrow_t&) noexcept { return TrackedAlloc(sizeB, __STDCPP_DEFAULT_NEW_ALIGNMENT__, false); }
+void* operator new(const size_t sizeB, const std::align_val_t alignment) { return TrackedAlloc(sizeB, static_cast<size_t>(alignment), true); }
+void* operator new[](const size_t sizeB, const std::align_val_t alignment) { return TrackedAlloc(sizeB, static_cast<size_t>(alignment), true); }
+void* operator new(const size_t sizeB, const std::align_val_t alignment, const std::nothrow_t&) noexcept { return TrackedAlloc(sizeB, static_cast<size_t>(alignment), false); }
+void* operator new[](const size_t sizeB, const std::align_val_t alignment, const std::nothrow_t&) noexcept { return TrackedAlloc(sizeB, static_cast<size_t>(alignment), false); }
+
+void operator delete(void* ptr) noexcept { TrackedFree(ptr, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+void operator delete[](void* ptr) noexcept { TrackedFree(ptr, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+void operator delete(void* ptr, size_t) noexcept { TrackedFree(ptr, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+void operator delete[](void* ptr, size_t) noexcept { TrackedFree(ptr, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { TrackedFree(ptr, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { TrackedFree(ptr, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+void operator delete(void* ptr, const std::align_val_t alignment) noexcept { TrackedFree(ptr, static_cast<size_t>(alignment)); }
+void operator delete[](void* ptr, const std::align_val_t alignment) noexcept { TrackedFree(ptr, static_cast<size_t>(alignment)); }
+void operator delete(void* ptr, size_t, const std::align_val_t alignment) noexcept { TrackedFree(ptr, static_cast<size_t>(alignment)); }
+void operator delete[](void* ptr, size_t, const std::align_val_t alignment) noexcept { TrackedFree(ptr, static_cast<size_t>(alignment)); }
+void operator delete(void* ptr, const std::align_val_t alignment, const std::nothrow_t&) noexcept { TrackedFree(ptr, static_cast<size_t>(alignment)); }
+void operator delete[](void* ptr, const std::align_val_t alignment, const std::nothrow_t&) noexcept { TrackedFree(ptr, static_cast<size_t>(alignment)); }
+
+#endif
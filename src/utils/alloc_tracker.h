@@ -0,0 +1,58 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+#include "common/const.h"
+
+namespace dt
+{
+    // 统计全局new/delete的次数和字节数，定义DT_ALLOC_TRACKING时才替换全局new/delete，否则统计始终为0
+    // 每个线程写自己的计数，BeginFrame汇总出上一帧所有线程的分配，并通过TracyAlloc/TracyFree让Tracy按zone统计
+    // 同时定义DT_ALLOC_ASSERT时，预热帧之后的帧只要有分配就抛出异常，用来防止渲染循环重新引入分配
+    class AllocTracker
+    {
+    public:
+        struct Stats
+        {
+            uint64_t allocCount = 0;
+            uint64_t allocSizeB = 0;
+            uint64_t freeCount = 0;
+        };
+
+        static constexpr bool ENABLED =
+#ifdef DT_ALLOC_TRACKING
+            true;
+#else
+            false;
+#endif
+
+        // 在主线程每帧开始时调用，结算上一帧
+        static void BeginFrame();
+
+        static Stats GetFrameStats() { return s_frameStats; }
+        // 当前线程到目前为止的累计值，两次调用相减可以得到一段代码的分配
+        static Stats GetThreadStats();
+
+        static void OnAlloc(size_t sizeB);
+        static void OnFree();
+
+    private:
+        struct alignas(64) ThreadCounter
+        {
+            std::atomic<uint64_t> allocCount = 0;
+            std::atomic<uint64_t> allocSizeB = 0;
+            std::atomic<uint64_t> freeCount = 0;
+        };
+
+        static ThreadCounter s_counters[ALLOC_TRACKER_MAX_THREAD_COUNT];
+        static std::atomic<uint32_t> s_counterCount;
+        // 指针是平凡初始化的，new里访问它不会再触发分配
+        static thread_local ThreadCounter* s_threadCounter;
+
+        static Stats s_totalStats;
+        static Stats s_frameStats;
+        static uint64_t s_frameIndex;
+
+        DT_NOINLINE static ThreadCounter* GetThreadCounter();
+    };
+}
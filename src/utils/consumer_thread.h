@@ -1,18 +1,22 @@
 #pragma once
+#include <condition_variable>
 #include <deque>
 #include <functional>
 #include <mutex>
-#include <boost/lockfree/queue.hpp>
+#include <thread>
 #include <tracy/Tracy.hpp>
 
+#include "utils/spsc_ring.h"
+
 namespace dt
 {
     template <typename T>
     class ConsumerThread
     {
     public:
+        // lockFreeCapacity大于0时使用无锁的单生产者环形队列，只能由同一个线程入队
         template <typename ConsumeFunc>
-        explicit ConsumerThread(ConsumeFunc&& f, const char* name = nullptr);
+        explicit ConsumerThread(ConsumeFunc&& f, const char* name = nullptr, uint32_t lockFreeCapacity = 0);
         ~ConsumerThread();
         ConsumerThread(const ConsumerThread& other) = delete;
         ConsumerThread(ConsumerThread&& other) noexcept = delete;
@@ -22,6 +26,7 @@ namespace dt
         bool IsStopped() const { return !m_thread.joinable(); }
 
         void Enqueue(const T& product);
+        void EnqueueBatch(const T* products, uint32_t count);
         void Stop(bool immediate = false);
         void Wait();
         void Join();
@@ -29,8 +34,14 @@ namespace dt
     private:
         template <class ConsumeFunc>
         void Thread(ConsumeFunc&& consumeFunc);
+        template <class ConsumeFunc>
+        void LockFreeThread(ConsumeFunc&& consumeFunc);
+        void WakeConsumer();
+        bool QueueEmpty() const { return m_lockFreeQueue ? m_lockFreeQueue->Empty() : m_productQueue.empty(); }
         
         std::deque<T> m_productQueue;
+        up<SpscRing<T>> m_lockFreeQueue;
+        std::atomic<bool> m_consumerWaiting = false;
         std::mutex m_mutex;
         std::condition_variable m_hasProductCond;
         std::condition_variable m_idleCond;
@@ -43,16 +54,28 @@ namespace dt
 
     template <typename T>
     template <typename ConsumeFunc>
-    ConsumerThread<T>::ConsumerThread(ConsumeFunc&& f, const char* name)
+    ConsumerThread<T>::ConsumerThread(ConsumeFunc&& f, const char* name, const uint32_t lockFreeCapacity)
     {
+        if (lockFreeCapacity > 0)
+        {
+            m_lockFreeQueue = mup<SpscRing<T>>(lockFreeCapacity);
+        }
+        
         m_thread = std::thread([this, f=std::move(f), name]
         {
             if (name)
             {
                 tracy::SetThreadName(name);
             }
-            
-            Thread(f);
+
+            if (m_lockFreeQueue)
+            {
+                LockFreeThread(f);
+            }
+            else
+            {
+                Thread(f);
+            }
         });
     }
 
@@ -71,11 +94,64 @@ namespace dt
 
         assert(!m_stopFlag);
 
+        if (m_lockFreeQueue)
+        {
+            EnqueueBatch(&product, 1);
+            return;
+        }
+
         std::lock_guard lock(m_mutex);
         m_productQueue.push_back(product);
         m_hasProductCond.notify_one();
     }
 
+    template <typename T>
+    void ConsumerThread<T>::EnqueueBatch(const T* products, const uint32_t count)
+    {
+        ZoneScoped;
+
+        assert(!m_stopFlag);
+
+        if (count == 0)
+        {
+            return;
+        }
+
+        if (!m_lockFreeQueue)
+        {
+            std::lock_guard lock(m_mutex);
+            m_productQueue.insert(m_productQueue.end(), products, products + count);
+            m_hasProductCond.notify_one();
+            return;
+        }
+
+        // 队列放得下时整批只发布一次写指针、唤醒一次，放不下时先唤醒消费者再等它腾出空间
+        uint32_t pushed = 0;
+        while (true)
+        {
+            pushed += m_lockFreeQueue->Push(products + pushed, count - pushed);
+            WakeConsumer();
+
+            if (pushed == count)
+            {
+                break;
+            }
+
+            std::this_thread::yield();
+        }
+    }
+
+    template <typename T>
+    void ConsumerThread<T>::WakeConsumer()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_consumerWaiting.load())
+        {
+            std::lock_guard lock(m_mutex);
+            m_hasProductCond.notify_one();
+        }
+    }
+
     template <typename T>
     void ConsumerThread<T>::Stop(const bool immediate)
     {
@@ -91,7 +167,7 @@ namespace dt
         std::unique_lock lock(m_mutex);
         m_idleCond.wait(lock, [this]
         {
-            return m_idle.load() && m_productQueue.empty();
+            return m_idle.load() && QueueEmpty();
         });
     }
 
@@ -150,4 +226,59 @@ namespace dt
         m_idle.store(true);
         m_idleCond.notify_all();
     }
+
+    template <typename T>
+    template <typename ConsumeFunc>
+    void ConsumerThread<T>::LockFreeThread(ConsumeFunc&& consumeFunc)
+    {
+        while (true)
+        {
+            if (m_stopImmediate.load())
+            {
+                break;
+            }
+
+            T product;
+            if (m_lockFreeQueue->Pop(product))
+            {
+                consumeFunc(product);
+                continue;
+            }
+
+            std::unique_lock lock(m_mutex);
+            if (m_stopFlag)
+            {
+                if (m_lockFreeQueue->Empty())
+                {
+                    break;
+                }
+
+                continue;
+            }
+
+            // 先声明自己要等待再检查队列，和生产者的发布形成配对，不会漏掉唤醒
+            m_consumerWaiting.store(true);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            if (m_lockFreeQueue->Empty())
+            {
+                m_idle.store(true);
+                m_idleCond.notify_all();
+
+                m_hasProductCond.wait(lock, [this]
+                {
+                    return !m_lockFreeQueue->Empty() || m_stopFlag;
+                });
+                m_idle.store(false);
+            }
+
+            m_consumerWaiting.store(false);
+        }
+
+        m_lockFreeQueue->Clear();
+
+        std::lock_guard lock(m_mutex);
+        m_idle.store(true);
+        m_idleCond.notify_all();
+    }
 }
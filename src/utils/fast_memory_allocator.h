@@ -1,16 +1,23 @@
 ﻿#pragma once
+#include <cassert>
+#include <cstddef>
+#include <new>
 
 #include "common/const.h"
 
 namespace dt
 {
+    // 在容量依次翻倍的内存块上线性分配，不单独释放，Reset后从头复用已经分配的内存块
     class FastMemoryAllocator
     {
     public:
+        static constexpr uint32_t FIRST_BLOCK_INDEX = 10;
+        static constexpr uint32_t MAX_ALIGNMENT = 64;
+
         FastMemoryAllocator()
         {
             m_memoryBlocks.resize(32);
-            m_curBlockIndex = 10;
+            m_curBlockIndex = FIRST_BLOCK_INDEX;
             m_curBlockSize = 0;
         }
 
@@ -18,7 +25,10 @@ namespace dt
         {
             for (auto& block : m_memoryBlocks)
             {
-                delete[] block;
+                if (block)
+                {
+                    operator delete[](block, static_cast<std::align_val_t>(MAX_ALIGNMENT));
+                }
             }
         }
 
@@ -27,9 +37,10 @@ namespace dt
         FastMemoryAllocator& operator=(const FastMemoryAllocator& other) = delete;
         FastMemoryAllocator& operator=(FastMemoryAllocator&& other) noexcept = delete;
 
-        void* Allocate(const uint32_t size)
+        void* Allocate(const uint32_t size, const uint32_t alignment = alignof(std::max_align_t))
         {
             assert(size > 0);
+            assert(alignment > 0 && alignment <= MAX_ALIGNMENT && (alignment & (alignment - 1)) == 0);
             
             auto blockIndex = m_curBlockIndex;
             auto blockSize = m_curBlockSize;
@@ -41,18 +52,19 @@ namespace dt
                     return nullptr;
                 }
                 
-                uint32_t blockCapacity = 1u << blockIndex;
+                uint64_t blockCapacity = 1ull << blockIndex;
+                uint64_t offset = (static_cast<uint64_t>(blockSize) + alignment - 1) & ~static_cast<uint64_t>(alignment - 1);
                 
-                if (blockSize + size <= blockCapacity)
+                if (offset + size <= blockCapacity)
                 {
                     if (!m_memoryBlocks[blockIndex])
                     {
-                        m_memoryBlocks[blockIndex] = new uint8_t[blockCapacity];
+                        m_memoryBlocks[blockIndex] = static_cast<uint8_t*>(operator new[](blockCapacity, static_cast<std::align_val_t>(MAX_ALIGNMENT)));
                     }
                     
-                    auto ptr = m_memoryBlocks[blockIndex] + blockSize;
+                    auto ptr = m_memoryBlocks[blockIndex] + offset;
                     m_curBlockIndex = blockIndex;
-                    m_curBlockSize = blockSize + size;
+                    m_curBlockSize = static_cast<uint32_t>(offset + size);
                     return ptr;
                 }
 
@@ -61,18 +73,24 @@ namespace dt
             }
         }
 
+        // 之前分配的内存全部作废，内存块保留，从当前用到的最大块开始分配，稳定后不再申请新块
+        void Reset()
+        {
+            m_curBlockSize = 0;
+        }
+
         template <typename T, typename... Args>
         T* Allocate(Args&&... args)
         {
             static_assert(std::is_trivially_constructible_v<T>, "T must be trivially constructible");
 
-            return new (Allocate(sizeof(T)))T(std::forward<Args>(args)...);
+            return new (Allocate(sizeof(T), alignof(T)))T(std::forward<Args>(args)...);
         }
 
         template <typename T, typename... Args>
         sp<T> AllocateShared(Args&&... args)
         {
-            auto ptr = new (Allocate(sizeof(T)))T(std::forward<Args>(args)...);
+            auto ptr = new (Allocate(sizeof(T), alignof(T)))T(std::forward<Args>(args)...);
             return sp<T>(ptr, [](T* t)
             {
                 t->~T();
@@ -0,0 +1,98 @@
+#include "fiber.h"
+
+#include <cassert>
+
+#include "common/utils.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace dt
+{
+    Fiber::Fiber()
+    {
+        m_isThread = true;
+
+#ifdef _WIN32
+        m_handle = ConvertThreadToFiber(nullptr);
+        if (!m_handle)
+        {
+            THROW_ERROR("Convert thread to fiber failed")
+        }
+#endif
+    }
+
+    Fiber::Fiber(const EntryFunc entry, void* arg, const size_t stackSizeB)
+    {
+        assert(entry);
+
+        m_entry = entry;
+        m_arg = arg;
+
+#ifdef _WIN32
+        m_handle = CreateFiber(stackSizeB, &Fiber::Entry, this);
+        if (!m_handle)
+        {
+            THROW_ERROR("Create fiber failed")
+        }
+#else
+        m_stack = std::make_unique<uint8_t[]>(stackSizeB);
+
+        getcontext(&m_context);
+        m_context.uc_stack.ss_sp = m_stack.get();
+        m_context.uc_stack.ss_size = stackSizeB;
+        m_context.uc_link = nullptr;
+
+        // makecontext只能传int参数，把指针拆成两半传入
+        auto ptr = reinterpret_cast<uintptr_t>(this);
+        makecontext(&m_context, reinterpret_cast<void(*)()>(&Fiber::Entry), 2,
+            static_cast<uint32_t>(static_cast<uint64_t>(ptr) >> 32), static_cast<uint32_t>(ptr));
+#endif
+    }
+
+    Fiber::~Fiber()
+    {
+#ifdef _WIN32
+        if (m_isThread)
+        {
+            ConvertFiberToThread();
+        }
+        else if (m_handle)
+        {
+            DeleteFiber(m_handle);
+        }
+#endif
+    }
+
+    void Fiber::Switch(Fiber& from, Fiber& to)
+    {
+        assert(&from != &to);
+
+#ifdef _WIN32
+        SwitchToFiber(to.m_handle);
+#else
+        swapcontext(&from.m_context, &to.m_context);
+#endif
+    }
+
+    void Fiber::Run()
+    {
+        m_entry(m_arg);
+
+        assert(false && "Fiber entry must not return");
+    }
+
+#ifdef _WIN32
+    void WINAPI Fiber::Entry(void* param)
+    {
+        static_cast<Fiber*>(param)->Run();
+    }
+#else
+    void Fiber::Entry(const uint32_t high, const uint32_t low)
+    {
+        auto ptr = static_cast<uintptr_t>(static_cast<uint64_t>(high) << 32 | low);
+        reinterpret_cast<Fiber*>(ptr)->Run();
+    }
+#endif
+}
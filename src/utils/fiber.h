@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+
+#include "common/const.h"
+
+#ifndef _WIN32
+#include <ucontext.h>
+#endif
+
+namespace dt
+{
+    // 可挂起的执行上下文，Windows下使用Fiber API，其他平台使用ucontext
+    // entry不能返回，结束时需要切换回其他fiber
+    class Fiber
+    {
+    public:
+        using EntryFunc = void(*)(void* arg);
+
+        // 把当前线程转换为fiber，作为切换到其他fiber的起点
+        Fiber();
+        Fiber(EntryFunc entry, void* arg, size_t stackSizeB);
+        ~Fiber();
+        Fiber(const Fiber& other) = delete;
+        Fiber(Fiber&& other) noexcept = delete;
+        Fiber& operator=(const Fiber& other) = delete;
+        Fiber& operator=(Fiber&& other) noexcept = delete;
+
+        static void Switch(Fiber& from, Fiber& to);
+
+    private:
+        EntryFunc m_entry = nullptr;
+        void* m_arg = nullptr;
+        bool m_isThread = false;
+
+#ifdef _WIN32
+        void* m_handle = nullptr;
+
+        static void __stdcall Entry(void* param);
+#else
+        ucontext_t m_context = {};
+        up<uint8_t[]> m_stack;
+
+        static void Entry(uint32_t high, uint32_t low);
+#endif
+
+        void Run();
+    };
+}
@@ -0,0 +1,42 @@
+#include "frame_arena.h"
+
+#include <tracy/Tracy.hpp>
+
+namespace dt
+{
+    void* FrameArena::Allocate(const uint32_t sizeB, const uint32_t alignment)
+    {
+        auto arena = GetThreadArena();
+        return arena->allocators[GetFrameIndex() % FRAME_COUNT].Allocate(sizeB, alignment);
+    }
+
+    void FrameArena::BeginFrame()
+    {
+        ZoneScoped;
+
+        auto nextFrameIndex = GetFrameIndex() + 1;
+
+        {
+            std::lock_guard lock(s_mutex);
+            for (auto& arena : s_arenas)
+            {
+                arena->allocators[nextFrameIndex % FRAME_COUNT].Reset();
+            }
+        }
+
+        s_frameIndex.store(nextFrameIndex, std::memory_order_release);
+    }
+
+    FrameArena::ThreadArena* FrameArena::GetThreadArena()
+    {
+        // 线程第一次分配时创建，之后一直保留
+        if (!s_threadArena)
+        {
+            std::lock_guard lock(s_mutex);
+            s_arenas.push_back(mup<ThreadArena>());
+            s_threadArena = s_arenas.back().get();
+        }
+
+        return s_threadArena;
+    }
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <type_traits>
+
+#include "common/const.h"
+#include "utils/fast_memory_allocator.h"
+
+namespace dt
+{
+    // 每帧的临时内存，每个线程各有一组分配器，分配时不加锁
+    // 按帧轮流使用FRAME_COUNT组分配器，BeginFrame只回收FRAME_COUNT帧之前的内存，渲染线程可以继续读取上一帧的数据
+    // 分配出的内存不会析构，只用于平凡析构的数据
+    class FrameArena
+    {
+    public:
+        static constexpr uint32_t FRAME_COUNT = 3;
+
+        static uint32_t GetFrameIndex() { return s_frameIndex.load(std::memory_order_acquire); }
+
+        static void* Allocate(uint32_t sizeB, uint32_t alignment = alignof(std::max_align_t));
+        template <typename T>
+        static T* AllocateArray(uint32_t count);
+
+        // 在帧之间调用，此时不能有其他线程正在分配
+        static void BeginFrame();
+
+    private:
+        struct ThreadArena
+        {
+            FastMemoryAllocator allocators[FRAME_COUNT];
+        };
+
+        inline static std::mutex s_mutex;
+        inline static vecup<ThreadArena> s_arenas;
+        inline static std::atomic<uint32_t> s_frameIndex = 0;
+        inline static thread_local ThreadArena* s_threadArena = nullptr;
+
+        DT_NOINLINE static ThreadArena* GetThreadArena();
+    };
+
+    template <typename T>
+    struct FrameAllocator
+    {
+        using value_type = T;
+
+        FrameAllocator() = default;
+        template <typename U>
+        FrameAllocator(const FrameAllocator<U>&) {}
+
+        T* allocate(size_t n);
+        void deallocate(T*, size_t) {}
+
+        template <typename U>
+        bool operator==(const FrameAllocator<U>&) const { return true; }
+        template <typename U>
+        bool operator!=(const FrameAllocator<U>&) const { return false; }
+    };
+
+    template <typename T>
+    using frame_vec = std::vector<T, FrameAllocator<T>>;
+
+    template <typename T>
+    T* FrameArena::AllocateArray(const uint32_t count)
+    {
+        static_assert(std::is_trivially_destructible_v<T>, "T must be trivially destructible");
+
+        return static_cast<T*>(Allocate(count * sizeof(T), alignof(T)));
+    }
+
+    template <typename T>
+    T* FrameAllocator<T>::allocate(const size_t n)
+    {
+        // 容器要求分配失败时抛出异常，不能返回空指针
+        if (n == 0 || n > UINT32_MAX / sizeof(T))
+        {
+            throw std::bad_alloc();
+        }
+
+        auto ptr = FrameArena::Allocate(static_cast<uint32_t>(n * sizeof(T)), alignof(T));
+        if (!ptr)
+        {
+            throw std::bad_alloc();
+        }
+
+        return static_cast<T*>(ptr);
+    }
+}
@@ -0,0 +1,189 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace dt
+{
+    template <typename Sig, size_t Capacity = 64>
+    class InlineFunc;
+
+    // 捕获内容不超过Capacity时直接存放在对象内部，不会分配堆内存
+    // 超出容量、对齐要求过高或移动可能抛异常的可调用对象退回到堆上存放，只在对象内部保存指针
+    template <typename R, typename... Args, size_t Capacity>
+    class InlineFunc<R(Args...), Capacity>
+    {
+        static_assert(Capacity >= sizeof(void*));
+
+    public:
+        InlineFunc() = default;
+        InlineFunc(std::nullptr_t) {}
+        ~InlineFunc();
+        InlineFunc(const InlineFunc& other) = delete;
+        InlineFunc(InlineFunc&& other) noexcept;
+        InlineFunc& operator=(const InlineFunc& other) = delete;
+        InlineFunc& operator=(InlineFunc&& other) noexcept;
+
+        template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, InlineFunc>>>
+        InlineFunc(F&& f);
+        template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, InlineFunc>>>
+        InlineFunc& operator=(F&& f);
+
+        explicit operator bool() const { return m_invoke != nullptr; }
+        bool operator==(std::nullptr_t) const { return m_invoke == nullptr; }
+        bool operator!=(std::nullptr_t) const { return m_invoke != nullptr; }
+
+        R operator()(Args... args) const;
+
+        void Reset();
+
+    private:
+        template <typename Func>
+        static constexpr bool IS_INLINE =
+            sizeof(Func) <= Capacity &&
+            alignof(Func) <= alignof(std::max_align_t) &&
+            std::is_nothrow_move_constructible_v<Func>;
+
+        using InvokeFunc = R(*)(void*, Args&&...);
+        using MoveFunc = void(*)(void* dst, void* src);
+        using DestroyFunc = void(*)(void*);
+
+        alignas(std::max_align_t) mutable uint8_t m_storage[Capacity];
+        InvokeFunc m_invoke = nullptr;
+        MoveFunc m_move = nullptr;
+        DestroyFunc m_destroy = nullptr;
+
+        template <typename F>
+        void Construct(F&& f);
+        void StealFrom(InlineFunc& other);
+    };
+
+    template <typename R, typename... Args, size_t Capacity>
+    InlineFunc<R(Args...), Capacity>::~InlineFunc()
+    {
+        Reset();
+    }
+
+    template <typename R, typename... Args, size_t Capacity>
+    InlineFunc<R(Args...), Capacity>::InlineFunc(InlineFunc&& other) noexcept
+    {
+        StealFrom(other);
+    }
+
+    template <typename R, typename... Args, size_t Capacity>
+    InlineFunc<R(Args...), Capacity>& InlineFunc<R(Args...), Capacity>::operator=(InlineFunc&& other) noexcept
+    {
+        if (this == &other)
+        {
+            return *this;
+        }
+
+        Reset();
+        StealFrom(other);
+
+        return *this;
+    }
+
+    template <typename R, typename... Args, size_t Capacity>
+    template <typename F, typename>
+    InlineFunc<R(Args...), Capacity>::InlineFunc(F&& f)
+    {
+        Construct(std::forward<F>(f));
+    }
+
+    template <typename R, typename... Args, size_t Capacity>
+    template <typename F, typename>
+    InlineFunc<R(Args...), Capacity>& InlineFunc<R(Args...), Capacity>::operator=(F&& f)
+    {
+        Reset();
+        Construct(std::forward<F>(f));
+
+        return *this;
+    }
+
+    template <typename R, typename... Args, size_t Capacity>
+    R InlineFunc<R(Args...), Capacity>::operator()(Args... args) const
+    {
+        assert(m_invoke);
+
+        return m_invoke(m_storage, std::forward<Args>(args)...);
+    }
+
+    template <typename R, typename... Args, size_t Capacity>
+    void InlineFunc<R(Args...), Capacity>::Reset()
+    {
+        if (m_destroy)
+        {
+            m_destroy(m_storage);
+        }
+
+        m_invoke = nullptr;
+        m_move = nullptr;
+        m_destroy = nullptr;
+    }
+
+    template <typename R, typename... Args, size_t Capacity>
+    template <typename F>
+    void InlineFunc<R(Args...), Capacity>::Construct(F&& f)
+    {
+        using Func = std::decay_t<F>;
+
+        if constexpr (IS_INLINE<Func>)
+        {
+            new (m_storage) Func(std::forward<F>(f));
+
+            m_invoke = [](void* storage, Args&&... args) -> R
+            {
+                return (*static_cast<Func*>(storage))(std::forward<Args>(args)...);
+            };
+            m_move = [](void* dst, void* src)
+            {
+                new (dst) Func(std::move(*static_cast<Func*>(src)));
+                static_cast<Func*>(src)->~Func();
+            };
+            m_destroy = [](void* storage)
+            {
+                static_cast<Func*>(storage)->~Func();
+            };
+        }
+        else
+        {
+            // 移动时只转移指针
+            *reinterpret_cast<Func**>(m_storage) = new Func(std::forward<F>(f));
+
+            m_invoke = [](void* storage, Args&&... args) -> R
+            {
+                return (**static_cast<Func**>(storage))(std::forward<Args>(args)...);
+            };
+            m_move = [](void* dst, void* src)
+            {
+                *static_cast<Func**>(dst) = *static_cast<Func**>(src);
+            };
+            m_destroy = [](void* storage)
+            {
+                delete *static_cast<Func**>(storage);
+            };
+        }
+    }
+
+    template <typename R, typename... Args, size_t Capacity>
+    void InlineFunc<R(Args...), Capacity>::StealFrom(InlineFunc& other)
+    {
+        if (!other.m_invoke)
+        {
+            return;
+        }
+
+        other.m_move(m_storage, other.m_storage);
+        m_invoke = other.m_invoke;
+        m_move = other.m_move;
+        m_destroy = other.m_destroy;
+
+        other.m_invoke = nullptr;
+        other.m_move = nullptr;
+        other.m_destroy = nullptr;
+    }
+}
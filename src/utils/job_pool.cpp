@@ -0,0 +1,10 @@
+#include "job_pool.h"
+
+namespace dt
+{
+    JobPool::ThreadCache& JobPool::GetThreadCache()
+    {
+        static thread_local ThreadCache cache;
+        return cache;
+    }
+}
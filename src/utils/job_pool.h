@@ -0,0 +1,237 @@
+#pragma once
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <mutex>
+#include <new>
+
+#include "common/const.h"
+
+namespace dt
+{
+    // 固定大小内存块的池，释放的块挂在空闲链表上复用，稳定运行后不再分配堆内存
+    // 每个线程缓存一小段空闲块，分配和释放平时不加锁，缓存用完或积攒过多时才和全局空闲链表成批交换
+    // 池本身不会析构，退出时仍被引用的job在静态析构阶段释放也是安全的，内存由JobScheduler析构时通过Release归还
+    class JobPool
+    {
+    public:
+        static constexpr size_t BLOCK_SIZE = 512;
+        static constexpr size_t BLOCK_ALIGNMENT = 64;
+        static constexpr uint32_t CHUNK_BLOCK_COUNT = 64;
+        static constexpr uint32_t CACHE_BATCH_COUNT = 16;
+
+        JobPool() = default;
+        ~JobPool() = default;
+        JobPool(const JobPool& other) = delete;
+        JobPool(JobPool&& other) noexcept = delete;
+        JobPool& operator=(const JobPool& other) = delete;
+        JobPool& operator=(JobPool&& other) noexcept = delete;
+
+        static JobPool& Ins();
+
+        uint32_t GetCapacity() const { return m_capacity.load(std::memory_order_relaxed); }
+        // 不在全局空闲链表上的块数，包括正在使用的和其他线程缓存的
+        uint32_t GetUsedCount() const { return GetCapacity() - m_freeCount.load(std::memory_order_relaxed); }
+
+        void* Alloc(size_t sizeB);
+        void Free(void* ptr);
+        // 先归还当前线程的缓存，所有块都回到全局空闲链表时归还所有内存，返回是否归还，否则保留到进程退出
+        // 其他线程的缓存在线程退出时归还，调用前worker应已退出
+        bool Release();
+
+    private:
+        struct FreeBlock
+        {
+            FreeBlock* next;
+        };
+
+        struct ThreadCache
+        {
+            FreeBlock* head = nullptr;
+            uint32_t count = 0;
+
+            ~ThreadCache();
+        };
+
+        std::mutex m_mutex;
+        FreeBlock* m_freeList = nullptr;
+        vec<void*> m_chunks;
+        std::atomic<uint32_t> m_capacity = 0;
+        std::atomic<uint32_t> m_freeCount = 0;
+
+        void Refill(ThreadCache& cache);
+        void Flush(ThreadCache& cache, uint32_t count);
+        void AddChunk();
+
+        DT_NOINLINE static ThreadCache& GetThreadCache();
+    };
+
+    template <typename T>
+    struct JobAllocator
+    {
+        using value_type = T;
+
+        JobAllocator() = default;
+        template <typename U>
+        JobAllocator(const JobAllocator<U>&) {}
+
+        T* allocate(size_t n);
+        void deallocate(T* ptr, size_t n);
+
+        template <typename U>
+        bool operator==(const JobAllocator<U>&) const { return true; }
+        template <typename U>
+        bool operator!=(const JobAllocator<U>&) const { return false; }
+    };
+
+    inline JobPool& JobPool::Ins()
+    {
+        static auto pool = new JobPool();
+        return *pool;
+    }
+
+    inline JobPool::ThreadCache::~ThreadCache()
+    {
+        if (count > 0)
+        {
+            Ins().Flush(*this, count);
+        }
+    }
+
+    inline void* JobPool::Alloc(const size_t sizeB)
+    {
+        assert(sizeB <= BLOCK_SIZE);
+
+        auto& cache = GetThreadCache();
+        if (!cache.head)
+        {
+            Refill(cache);
+        }
+
+        auto block = cache.head;
+        cache.head = block->next;
+        --cache.count;
+
+        return block;
+    }
+
+    inline void JobPool::Free(void* ptr)
+    {
+        if (!ptr)
+        {
+            return;
+        }
+
+        // job常在worker上释放、在主线程上分配，缓存积攒到两批时归还一批
+        auto& cache = GetThreadCache();
+        auto block = static_cast<FreeBlock*>(ptr);
+        block->next = cache.head;
+        cache.head = block;
+        ++cache.count;
+
+        if (cache.count >= CACHE_BATCH_COUNT * 2)
+        {
+            Flush(cache, CACHE_BATCH_COUNT);
+        }
+    }
+
+    inline bool JobPool::Release()
+    {
+        auto& cache = GetThreadCache();
+        Flush(cache, cache.count);
+
+        std::lock_guard lock(m_mutex);
+
+        if (m_freeCount.load(std::memory_order_relaxed) != m_capacity.load(std::memory_order_relaxed))
+        {
+            return false;
+        }
+
+        for (auto chunk : m_chunks)
+        {
+            operator delete(chunk, static_cast<std::align_val_t>(BLOCK_ALIGNMENT));
+        }
+        m_chunks.clear();
+        m_chunks.shrink_to_fit();
+        m_freeList = nullptr;
+        m_capacity.store(0, std::memory_order_relaxed);
+        m_freeCount.store(0, std::memory_order_relaxed);
+
+        return true;
+    }
+
+    inline void JobPool::Refill(ThreadCache& cache)
+    {
+        std::lock_guard lock(m_mutex);
+
+        for (uint32_t i = 0; i < CACHE_BATCH_COUNT; ++i)
+        {
+            if (!m_freeList)
+            {
+                AddChunk();
+            }
+
+            auto block = m_freeList;
+            m_freeList = block->next;
+            block->next = cache.head;
+            cache.head = block;
+        }
+
+        cache.count += CACHE_BATCH_COUNT;
+        m_freeCount.fetch_sub(CACHE_BATCH_COUNT, std::memory_order_relaxed);
+    }
+
+    inline void JobPool::Flush(ThreadCache& cache, const uint32_t count)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+
+        std::lock_guard lock(m_mutex);
+
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            auto block = cache.head;
+            cache.head = block->next;
+            block->next = m_freeList;
+            m_freeList = block;
+        }
+
+        cache.count -= count;
+        m_freeCount.fetch_add(count, std::memory_order_relaxed);
+    }
+
+    inline void JobPool::AddChunk()
+    {
+        auto chunk = static_cast<uint8_t*>(operator new(BLOCK_SIZE * CHUNK_BLOCK_COUNT, static_cast<std::align_val_t>(BLOCK_ALIGNMENT)));
+        m_chunks.push_back(chunk);
+
+        for (uint32_t i = CHUNK_BLOCK_COUNT; i > 0; --i)
+        {
+            auto block = reinterpret_cast<FreeBlock*>(chunk + (i - 1) * BLOCK_SIZE);
+            block->next = m_freeList;
+            m_freeList = block;
+        }
+
+        m_capacity.fetch_add(CHUNK_BLOCK_COUNT, std::memory_order_relaxed);
+        m_freeCount.fetch_add(CHUNK_BLOCK_COUNT, std::memory_order_relaxed);
+    }
+
+
+    template <typename T>
+    T* JobAllocator<T>::allocate(const size_t n)
+    {
+        static_assert(sizeof(T) <= JobPool::BLOCK_SIZE, "Type is too large for JobPool");
+        static_assert(alignof(T) <= JobPool::BLOCK_ALIGNMENT, "Type is over-aligned for JobPool");
+        assert(n == 1);
+
+        return static_cast<T*>(JobPool::Ins().Alloc(n * sizeof(T)));
+    }
+
+    template <typename T>
+    void JobAllocator<T>::deallocate(T* ptr, size_t)
+    {
+        JobPool::Ins().Free(ptr);
+    }
+}
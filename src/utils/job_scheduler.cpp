@@ -11,86 +11,388 @@ namespace dt
     {
         ZoneScopedC(TRACY_IDLE_COLOR);
 
-        std::unique_lock lock(m_accessMutex);
+        std::unique_lock lock(s_signalMutex);
         
-        m_startingSignal.wait(lock, [this]
+        s_signal.wait(lock, [this]
         {
-            return m_exceptTaskNum != 0;
+            return m_exceptTaskNum.load() != 0;
         });
     }
 
-    void Job::WaitForStop()
+    void Job::WaitForStop(const bool help)
     {
         ZoneScopedC(TRACY_IDLE_COLOR);
 
-        assert(m_exceptTaskNum != 0 && "Job has not been scheduled");
+        if (ThreadPool::IsInFiber())
+        {
+            SuspendUntilComplete();
+            return;
+        }
+
+        if (help)
+        {
+            Help();
+        }
+
+        assert((m_exceptTaskNum.load() != 0 || !IsRoot()) && "Job has not been scheduled");
         
-        std::unique_lock lock(m_accessMutex);
+        std::unique_lock lock(s_signalMutex);
         
-        m_completeSignal.wait(lock, [this]
+        s_signal.wait(lock, [this]
         {
             return m_completed.load();
         });
     }
 
+    void Job::Help()
+    {
+        if (m_exceptTaskNum.load(std::memory_order_acquire) == 0)
+        {
+            return;
+        }
+
+        auto scheduler = m_scheduler;
+        auto parallel = m_parallelTaskFunc != nullptr;
+        auto generation = GetCurrentGeneration();
+
+        // 先领取自己剩余的batch，再执行线程池里其他就绪的task，都没有时说明剩下的工作正在worker上执行
+        while (!IsComplete())
+        {
+            if (parallel && scheduler->RunParallelBatch(this, generation))
+            {
+                continue;
+            }
+
+            if (!scheduler->TryRunOne())
+            {
+                break;
+            }
+        }
+    }
+
+    void Job::SuspendUntilComplete()
+    {
+        // 在worker切走fiber之后才登记，完成时登记过的fiber一定已经挂起
+        ThreadPool::ParkFunc park = [this](ThreadPool::TaskFiber* fiber)
+        {
+            std::lock_guard lock(s_signalMutex);
+            if (m_completed.load())
+            {
+                return false;
+            }
+
+            m_waitingFibers.push_back(fiber);
+            return true;
+        };
+
+        while (!IsComplete())
+        {
+            ThreadPool::Suspend(park);
+        }
+    }
+
+    void Job::ResumeWaitingFibers()
+    {
+        std::lock_guard lock(s_signalMutex);
+        for (auto fiber : m_waitingFibers)
+        {
+            ThreadPool::Resume(fiber);
+        }
+        m_waitingFibers.clear();
+    }
+
     void Job::AppendNext(crsp<Job> next)
     {
-        std::lock_guard lock(m_accessMutex);
+        next->DependsOn(shared_from_this());
+    }
+
+    void Job::DependsOn(crsp<Job> dependency)
+    {
+        assert(dependency);
+        
+        if (Reaches(dependency.get()))
+        {
+            THROW_ERROR("Job dependency cycle detected")
+        }
 
-        m_next.push_back(next);
+        dependency->m_dependents.push_back(shared_from_this());
+
+        m_dependencyCount++;
+        m_pendingDependencyCount.fetch_add(1);
     }
 
     bool Job::CompleteOnce()
     {
-        std::lock_guard lock(m_accessMutex);
-        
-        m_completeTaskNum++;
-        if (m_completeTaskNum == m_exceptTaskNum)
+        return m_completeTaskNum.fetch_add(1, std::memory_order_acq_rel) + 1 == m_exceptTaskNum.load(std::memory_order_relaxed);
+    }
+
+    bool Job::ClaimBatch(const uint16_t generation, uint32_t& batchIndex)
+    {
+        constexpr uint64_t mask = MAX_BATCH_COUNT;
+
+        auto cursor = m_batchCursor.load(std::memory_order_acquire);
+        while (true)
+        {
+            auto index = static_cast<uint32_t>(cursor & mask);
+            auto count = static_cast<uint32_t>((cursor >> BATCH_BITS) & mask);
+            if (static_cast<uint16_t>(cursor >> (BATCH_BITS * 2)) != generation || index >= count)
+            {
+                return false;
+            }
+
+            if (m_batchCursor.compare_exchange_weak(cursor, cursor + 1, std::memory_order_acquire))
+            {
+                batchIndex = index;
+                return true;
+            }
+        }
+    }
+
+    uint16_t Job::GetCurrentGeneration() const
+    {
+        return static_cast<uint16_t>(m_batchCursor.load(std::memory_order_acquire) >> (BATCH_BITS * 2));
+    }
+
+    bool Job::ReleaseDependency()
+    {
+        return m_pendingDependencyCount.fetch_sub(1, std::memory_order_acq_rel) == 1;
+    }
+
+    void Job::UpdateBatchSize(const uint32_t threadCount)
+    {
+        auto timeNs = m_batchTimeNs.exchange(0);
+        auto elemCount = m_batchElemCount.exchange(0);
+        if (m_targetBatchTimeUs <= 0.0f || elemCount == 0)
         {
-            m_completed = true;
+            return;
+        }
+
+        auto elemTimeNs = (std::max)(static_cast<double>(timeNs) / elemCount, 1.0);
+        auto targetBatchSize = m_targetBatchTimeUs * 1000.0 / elemTimeNs;
+
+        // 平滑跨帧的测量抖动，并保证每个worker至少能分到一个batch
+        auto batchSize = m_tunedBatchSize == 0 ? targetBatchSize : m_tunedBatchSize * 0.75 + targetBatchSize * 0.25;
+        auto maxBatchSize = (std::max)(ceil_div(m_taskElemCount, threadCount), m_minBatchSize);
+        m_tunedBatchSize = std::clamp(static_cast<uint32_t>(batchSize), m_minBatchSize, maxBatchSize);
+
+        if (m_name)
+        {
+            TracyPlot(m_name, static_cast<int64_t>(m_tunedBatchSize));
+        }
+    }
+
+    bool Job::Hold(crsp<Job> self, const uint32_t taskCount)
+    {
+        assert(self.get() == this);
+
+        LockHold();
+        auto held = m_holdCount.fetch_add(taskCount, std::memory_order_relaxed) == 0;
+        if (held)
+        {
+            m_selfRef = self;
+        }
+        UnlockHold();
+
+        return held;
+    }
+
+    bool Job::Unhold()
+    {
+        // 不是最后一个task时直接递减，之后不再访问job
+        auto count = m_holdCount.load(std::memory_order_relaxed);
+        while (count > 1)
+        {
+            if (m_holdCount.compare_exchange_weak(count, count - 1, std::memory_order_acq_rel, std::memory_order_relaxed))
+            {
+                return false;
+            }
+        }
+
+        // 可能是最后一个task，加锁后再递减，和Hold交错时不会释放刚装填的引用，解锁后才释放引用
+        sp<Job> self;
+        LockHold();
+        if (m_holdCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            self = std::move(m_selfRef);
+        }
+        UnlockHold();
+
+        return self != nullptr;
+    }
+
+    void Job::LockHold()
+    {
+        while (m_holdLock.exchange(true, std::memory_order_acquire))
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    void Job::UnlockHold()
+    {
+        m_holdLock.store(false, std::memory_order_release);
+    }
+
+    void Job::Reset()
+    {
+        // 只等待叶子job时，前置job可能已经派发了后继、还没有标记完成，等上一轮都标记完成再重置，否则迟到的完成标记会覆盖重置
+        while (true)
+        {
+            Job* running = nullptr;
+            VisitDependents([&running](Job* job)
+            {
+                if (job->m_exceptTaskNum.load() != 0 && !job->m_completed.load())
+                {
+                    running = job;
+                    return false;
+                }
+                return true;
+            });
+
+            if (!running)
+            {
+                break;
+            }
+
+            // 在遍历之外等待，fiber模式下挂起后可能在其他线程恢复
+            running->WaitForStop();
+        }
+
+        VisitDependents([](Job* job)
+        {
+            job->m_pendingDependencyCount.store(job->m_dependencyCount, std::memory_order_relaxed);
+            job->m_exceptTaskNum.store(0, std::memory_order_relaxed);
+            job->m_completeTaskNum.store(0, std::memory_order_relaxed);
+            job->m_completed.store(false);
             return true;
+        });
+    }
+
+    bool Job::Reaches(const Job* target)
+    {
+        auto reached = false;
+        VisitDependents([target, &reached](const Job* job)
+        {
+            reached = job == target;
+            return !reached;
+        });
+
+        return reached;
+    }
+
+    void Job::Notify()
+    {
+        {
+            std::lock_guard lock(s_signalMutex);
+        }
+        s_signal.notify_all();
+    }
+
+    void JobGraph::Add(crsp<Job> job)
+    {
+        if (!exists(m_jobs, job))
+        {
+            m_jobs.push_back(job);
+        }
+    }
+
+    void JobGraph::AddDependency(crsp<Job> job, crsp<Job> dependency)
+    {
+        Add(job);
+        Add(dependency);
+
+        job->DependsOn(dependency);
+    }
+
+    void JobGraph::Submit(JobScheduler* scheduler)
+    {
+        ZoneScoped;
+
+        // 先重置所有根，共享的后继只在提交前装填一次计数
+        for (auto& job : m_jobs)
+        {
+            if (job->IsRoot())
+            {
+                job->Reset();
+            }
+        }
+
+        for (auto& job : m_jobs)
+        {
+            if (job->IsRoot())
+            {
+                scheduler->Schedule(job, false);
+            }
+        }
+    }
+
+    void JobGraph::WaitForStop(const bool help)
+    {
+        for (auto& job : m_jobs)
+        {
+            job->WaitForStop(help);
         }
-        return false;
     }
     
     
-    JobScheduler::JobScheduler()
+    JobScheduler::JobScheduler(const uint32_t threadCount, const bool pinThreads, const bool useFibers)
     {
-        m_threadPool = std::make_unique<ThreadPool>(JOB_THREAD_COUNT);
+        // threadCount为0时根据硬件线程数决定
+        auto count = threadCount > 0 ? threadCount : GetDefaultThreadCount();
+        m_threadPool = std::make_unique<ThreadPool>(count, pinThreads, useFibers);
     }
 
     JobScheduler::~JobScheduler()
     {
-        while (!m_runningParallelTasks.empty())
+        // task捕获了scheduler，等线程池里所有job的task都执行完再销毁线程池
         {
-            sp<Job> job = nullptr;
-            
+            std::unique_lock lock(Job::s_signalMutex);
+            Job::s_signal.wait(lock, [this]
             {
-                std::lock_guard lock(m_schedulerMutex);
-                if (m_runningParallelTasks.empty())
-                {
-                    break;
-                }
-                job = m_runningParallelTasks[0].second;
-            }
-            
-            job->WaitForStop();
+                return m_runningJobCount.load() == 0;
+            });
         }
-        
+
         m_threadPool.reset();
+
+        // 仍被外部持有的job之后释放时还会归还到池里，这种情况下池的内存保留到进程退出
+        if (!JobPool::Ins().Release())
+        {
+            log_warning("%u jobs are still referenced when JobScheduler is destroyed", JobPool::Ins().GetUsedCount());
+        }
     }
 
-    void JobScheduler::Schedule(crsp<Job> job)
+    uint32_t JobScheduler::GetDefaultThreadCount()
+    {
+        auto hardwareThreadCount = std::thread::hardware_concurrency();
+        if (hardwareThreadCount <= JOB_RESERVED_THREAD_COUNT)
+        {
+            return JOB_MIN_THREAD_COUNT;
+        }
+
+        return (std::max)(hardwareThreadCount - JOB_RESERVED_THREAD_COUNT, static_cast<uint32_t>(JOB_MIN_THREAD_COUNT));
+    }
+
+    void JobScheduler::Schedule(crsp<Job> job, const bool reset)
+    {
+        assert(job->IsRoot() && "Jobs with dependencies are scheduled when their last dependency completes");
+
+        if (reset)
+        {
+            job->Reset();
+        }
+
+        Dispatch(job);
+    }
+
+    void JobScheduler::Dispatch(crsp<Job> job)
     {
-        std::lock_guard lock0(m_schedulerMutex);
-        std::lock_guard lock1(job->m_accessMutex);
-        
         assert(!job->m_completed);
         assert(job->m_exceptTaskNum == 0);
-        assert(!find(m_runningParallelTasks, job->m_taskGroupId));
-        assert(!(job->m_taskFunc == nullptr && job->m_parallelTaskFunc == nullptr));
-        assert(!(job->m_taskFunc != nullptr && job->m_parallelTaskFunc != nullptr));
-        
+        assert((job->m_taskFunc != nullptr) != (job->m_parallelTaskFunc != nullptr));
+
+        job->m_scheduler = this;
+
         if (job->m_taskFunc != nullptr)
         {
             ScheduleCommonJob(job);
@@ -99,25 +401,26 @@ namespace dt
         {
             ScheduleParallelJob(job);
         }
-        
-        insert(m_runningParallelTasks, job->m_taskGroupId, job);
 
-        job->m_startingSignal.notify_all();
+        Job::Notify();
     }
 
     void JobScheduler::ScheduleCommonJob(crsp<Job> job)
     {
-        job->m_exceptTaskNum = 1;
-        job->m_completeTaskNum = 0;
-        
-        m_threadPool->Run([job, this]
+        job->m_completeTaskNum.store(0, std::memory_order_relaxed);
+        job->m_exceptTaskNum.store(1, std::memory_order_release);
+
+        HoldJob(job, 1);
+        m_threadPool->Run([job = job.get(), this]
         {
-            (*job->m_taskFunc)();
+            job->m_taskFunc();
 
             if (job->CompleteOnce())
             {
-                this->JobComplete(job);
+                JobComplete(job);
             }
+
+            ReleaseTask(job);
         }, job->m_priority);
     }
 
@@ -126,43 +429,102 @@ namespace dt
         assert(job->m_minBatchSize > 0);
         assert(job->m_taskElemCount != 0);
 
-        auto batchSize = ceil_div(job->m_taskElemCount, JOB_THREAD_COUNT * 5);
-        batchSize = (std::max)(batchSize, job->m_minBatchSize);
+        auto batchSize = job->m_tunedBatchSize;
+        if (batchSize == 0)
+        {
+            batchSize = ceil_div(job->m_taskElemCount, GetThreadCount() * JOB_BATCH_COUNT_PER_THREAD);
+            batchSize = (std::max)(batchSize, job->m_minBatchSize);
+        }
         assert(batchSize > 0);
         
-        job->m_exceptTaskNum = 0;
-        for (uint32_t start = 0; start < job->m_taskElemCount; start += batchSize)
+        auto batchCount = ceil_div(job->m_taskElemCount, batchSize);
+        assert(batchCount <= Job::MAX_BATCH_COUNT);
+
+        auto generation = ++job->m_submitGeneration;
+        job->m_batchSize = batchSize;
+        job->m_completeTaskNum.store(0, std::memory_order_relaxed);
+        job->m_exceptTaskNum.store(batchCount, std::memory_order_release);
+        job->m_batchCursor.store(
+            static_cast<uint64_t>(generation) << (Job::BATCH_BITS * 2) | static_cast<uint64_t>(batchCount) << Job::BATCH_BITS,
+            std::memory_order_release);
+        
+        // 每个task领取下一个未执行的batch，等待中的线程也可以直接领取
+        HoldJob(job, batchCount);
+        m_threadPool->RunMany([job = job.get(), this, generation]
+        {
+            RunParallelBatch(job, generation);
+            ReleaseTask(job);
+        }, batchCount, job->m_priority);
+    }
+
+    void JobScheduler::HoldJob(crsp<Job> job, const uint32_t taskCount)
+    {
+        // 必须在task进入线程池之前调用，计数不会先减后加
+        if (job->Hold(job, taskCount))
         {
-            job->m_exceptTaskNum++;
+            m_runningJobCount.fetch_add(1, std::memory_order_relaxed);
         }
-        
-        for (uint32_t start = 0; start < job->m_taskElemCount; start += batchSize)
+    }
+
+    void JobScheduler::ReleaseTask(Job* job)
+    {
+        // job释放之后不能再访问，只访问scheduler
+        if (job->Unhold() && m_runningJobCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
         {
-            auto end = (std::min)(start + batchSize, job->m_taskElemCount);
-            m_threadPool->Run([start, end, job, this]
-            {
-                (*job->m_parallelTaskFunc)(start, end);
+            Job::Notify();
+        }
+    }
 
-                if (job->CompleteOnce())
-                {
-                    this->JobComplete(job);
-                }
-            }, job->m_priority);
+    bool JobScheduler::RunParallelBatch(Job* job, const uint16_t generation)
+    {
+        uint32_t batchIndex;
+        if (!job->ClaimBatch(generation, batchIndex))
+        {
+            return false;
+        }
+
+        auto start = batchIndex * job->m_batchSize;
+        auto end = (std::min)(start + job->m_batchSize, job->m_taskElemCount);
+
+        auto startTime = std::chrono::steady_clock::now();
+        job->m_parallelTaskFunc(start, end);
+        auto timeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count();
+
+        job->m_batchTimeNs.fetch_add(timeNs, std::memory_order_relaxed);
+        job->m_batchElemCount.fetch_add(end - start, std::memory_order_relaxed);
+
+        if (job->CompleteOnce())
+        {
+            JobComplete(job);
         }
+
+        return true;
+    }
+
+    bool JobScheduler::TryRunOne()
+    {
+        return m_threadPool->TryRunOne();
     }
     
-    void JobScheduler::JobComplete(crsp<Job> job)
+    void JobScheduler::JobComplete(Job* job)
     {
-        for (auto& next : job->m_next)
+        if (job->m_parallelTaskFunc != nullptr)
         {
-            Schedule(next);
+            job->UpdateBatchSize(GetThreadCount());
         }
-        
+
+        // 先派发后继再标记完成，等待此job的线程返回后重新提交时，后继都已经派发，Reset不会和派发交错
+        for (auto& dependent : job->m_dependents)
         {
-            std::lock_guard lock(this->m_schedulerMutex);
-            remove(this->m_runningParallelTasks, job->m_taskGroupId);
+            if (dependent->ReleaseDependency())
+            {
+                Dispatch(dependent);
+            }
         }
 
-        job->m_completeSignal.notify_all();
+        job->m_completed.store(true, std::memory_order_release);
+
+        job->ResumeWaitingFibers();
+        Job::Notify();
     }
 }
@@ -1,86 +1,216 @@
 #pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <functional>
 #include <mutex>
 #include <tracy/Tracy.hpp>
 
 #include "common/const.h"
+#include "utils/inline_func.h"
+#include "utils/job_pool.h"
 #include "utils/thread_pool.h"
 
 namespace dt
 {
-    using TaskFunc = std::function<void()>;
-    using ParallelTaskFunc = std::function<void(uint32_t, uint32_t)>;
+    using TaskFunc = InlineFunc<void()>;
+    using ParallelTaskFunc = InlineFunc<void(uint32_t, uint32_t)>;
 
-    class Job
+    class JobScheduler;
+
+    class Job : public std::enable_shared_from_this<Job>
     {
     public:
         Job() = default;
 
         void WaitForStart();
-        void WaitForStop();
+        void WaitForStop(bool help = false);
         void AppendNext(crsp<Job> next);
+        void DependsOn(crsp<Job> dependency);
 
         bool IsComplete() const { return m_completed.load(); }
+        bool IsRoot() const { return m_dependencyCount == 0; }
         void SetMinBatchSize(const uint32_t minBatchSize) { m_minBatchSize = minBatchSize; }
         void SetPriority(const int32_t priority) { m_priority = priority; }
-        
+        void SetTargetBatchTime(const float targetBatchTimeUs) { m_targetBatchTimeUs = targetBatchTimeUs; }
+        void SetName(const char* name) { m_name = name; }
+        uint32_t GetTunedBatchSize() const { return m_tunedBatchSize; }
+
+        // 重置自身及所有后继job并重新装填依赖计数，上一轮还有job在执行时先等待它们完成
+        // 多个根job共享后继时要先重置所有根再提交，否则后提交的根会把已经放行的计数重新装填
+        void Reset();
+
+        // 捕获内容超过InlineFunc的64字节时会在堆上分配，热路径上的job应只捕获指针和少量值
         template <typename TaskFunc>
         static sp<Job> CreateCommon(TaskFunc&& f);
         template <typename TaskFunc>
         static sp<Job> CreateParallel(uint32_t taskElemCount, TaskFunc&& f);
 
     private:
+        static constexpr uint32_t BATCH_BITS = 24;
+        static constexpr uint32_t MAX_BATCH_COUNT = (1u << BATCH_BITS) - 1;
+
         int32_t m_priority = 0;
         uint32_t m_taskElemCount = 0;
         uint32_t m_minBatchSize = 32;
-        size_t m_taskGroupId = 0;
-        
-        std::optional<TaskFunc> m_taskFunc = std::nullopt;
-        std::optional<ParallelTaskFunc> m_parallelTaskFunc = std::nullopt;
-        
-        uint32_t m_exceptTaskNum = 0;
-        uint32_t m_completeTaskNum = 0;
+        uint32_t m_batchSize = 0;
+        JobScheduler* m_scheduler = nullptr;
+        const char* m_name = nullptr;
+
+        TaskFunc m_taskFunc;
+        ParallelTaskFunc m_parallelTaskFunc;
+
+        // 高16位为提交代数，中间24位为batch数量，低24位为下一个batch，上一轮遗留的task因代数不同领不到新一轮的batch
+        std::atomic<uint64_t> m_batchCursor = 0;
+        uint16_t m_submitGeneration = 0;
+
+        std::atomic<uint32_t> m_exceptTaskNum = 0;
+        std::atomic<uint32_t> m_completeTaskNum = 0;
         std::atomic_bool m_completed = false;
 
-        vecsp<Job> m_next;
-        
-        std::mutex m_accessMutex;
-        std::condition_variable m_startingSignal;
-        std::condition_variable m_completeSignal;
-        
+        // 记录每轮batch的总耗时和元素数，完成时按单个元素的耗时把batch大小调整到目标时长，为0时不调整
+        float m_targetBatchTimeUs = 100.0f;
+        uint32_t m_tunedBatchSize = 0;
+        std::atomic<uint64_t> m_batchTimeNs = 0;
+        std::atomic<uint32_t> m_batchElemCount = 0;
+
+        // 依赖此job的job，以及此job的前置job数量，m_pendingDependencyCount在Reset时重新装填以便下一帧重复提交
+        // 依赖关系需要在提交前由同一个线程构建完成
+        vecsp<Job> m_dependents;
+        uint32_t m_dependencyCount = 0;
+        std::atomic<uint32_t> m_pendingDependencyCount = 0;
+        // 不同线程可能同时Schedule共享后继的job，交叉遍历时一个job最多被多访问一次，visitor都是幂等的
+        std::atomic<uint32_t> m_visitMark = 0;
+
+        // fiber模式下等待此job的fiber，完成时重新交给线程池
+        vec<ThreadPool::TaskFiber*> m_waitingFibers;
+
+        // 线程池里还没执行完的task数量，task只捕获裸指针，数量不为0时由m_selfRef保持job存活
+        // Help可能领完所有batch，剩下的task执行时只检查代数就退出，要等它们都执行完才能释放
+        // 从0开始装填和减到0都在m_holdLock内进行，重新提交和上一轮最后一个task的释放不会交错
+        std::atomic<uint32_t> m_holdCount = 0;
+        std::atomic_bool m_holdLock = false;
+        sp<Job> m_selfRef;
+
+        // 所有job共用一个等待信号，避免每个job持有mutex和condition_variable
+        inline static std::mutex s_signalMutex;
+        inline static std::condition_variable s_signal;
+        inline static std::atomic<uint32_t> s_visitMark = 0;
+
+        void Help();
+        void SuspendUntilComplete();
+        void ResumeWaitingFibers();
         bool CompleteOnce();
+        bool ClaimBatch(uint16_t generation, uint32_t& batchIndex);
+        uint16_t GetCurrentGeneration() const;
+        bool ReleaseDependency();
+        void UpdateBatchSize(uint32_t threadCount);
+        bool Hold(crsp<Job> self, uint32_t taskCount);
+        bool Unhold();
+        void LockHold();
+        void UnlockHold();
+        bool Reaches(const Job* target);
+        template <typename Visitor>
+        void VisitDependents(Visitor&& visitor);
+
+        static void Notify();
 
         friend class JobScheduler;
     };
-    
+
     class JobScheduler
     {
     public:
-        JobScheduler();
+        // useFibers为true时job在fiber上执行，job内部等待其他job时只挂起fiber，不会占住worker
+        explicit JobScheduler(uint32_t threadCount = 0, bool pinThreads = false, bool useFibers = false);
         ~JobScheduler();
         JobScheduler(const JobScheduler& other) = delete;
         JobScheduler(JobScheduler&& other) noexcept = delete;
         JobScheduler& operator=(const JobScheduler& other) = delete;
         JobScheduler& operator=(JobScheduler&& other) noexcept = delete;
 
-        void Schedule(crsp<Job> job);
+        uint32_t GetThreadCount() const { return m_threadPool->GetThreadCount(); }
+        bool IsFiberMode() const { return m_threadPool->IsFiberMode(); }
+
+        // reset为false时调用方已经用Job::Reset重置过整组job
+        void Schedule(crsp<Job> job, bool reset = true);
+
+        // 后台任务不参与依赖，只在没有帧任务时执行，见ThreadPool::RunBackground
+        template <typename F>
+        void RunBackground(F&& task) { m_threadPool->RunBackground(std::forward<F>(task)); }
+        void BeginFrame(const float backgroundBudgetMs = JOB_BACKGROUND_BUDGET_MS) { m_threadPool->BeginFrame(backgroundBudgetMs); }
+        bool ShouldYieldBackground() const { return m_threadPool->ShouldYieldBackground(); }
+
+        static uint32_t GetDefaultThreadCount();
 
     private:
 
         up<ThreadPool> m_threadPool;
-        vec<std::pair<size_t, sp<Job>>> m_runningParallelTasks;
-        std::mutex m_schedulerMutex;
+        // 还有task在线程池里的job数量，析构时等待它们执行完
+        std::atomic<uint32_t> m_runningJobCount = 0;
 
+        void Dispatch(crsp<Job> job);
         void ScheduleCommonJob(crsp<Job> job);
         void ScheduleParallelJob(crsp<Job> job);
-        void JobComplete(crsp<Job> job);
+        void HoldJob(crsp<Job> job, uint32_t taskCount);
+        void ReleaseTask(Job* job);
+        bool RunParallelBatch(Job* job, uint16_t generation);
+        bool TryRunOne();
+        void JobComplete(Job* job);
+
+        friend class Job;
     };
 
+    // 一组有依赖关系的job，每帧构建一次后可重复提交，提交时只调度没有前置依赖的job
+    class JobGraph
+    {
+    public:
+        crvecsp<Job> GetJobs() const { return m_jobs; }
+
+        void Add(crsp<Job> job);
+        void AddDependency(crsp<Job> job, crsp<Job> dependency);
+        void Submit(JobScheduler* scheduler);
+        void WaitForStop(bool help = false);
+
+    private:
+        vecsp<Job> m_jobs;
+    };
+
+    template <typename Visitor>
+    void Job::VisitDependents(Visitor&& visitor)
+    {
+        // 深度优先遍历自身及所有后继job，用访问标记代替集合，每个job只访问一次，visitor返回false时停止
+        thread_local vec<Job*> stack;
+
+        auto mark = s_visitMark.fetch_add(1) + 1;
+        stack.clear();
+        stack.push_back(this);
+        while (!stack.empty())
+        {
+            auto job = stack.back();
+            stack.pop_back();
+
+            if (job->m_visitMark.exchange(mark, std::memory_order_relaxed) == mark)
+            {
+                continue;
+            }
+
+            if (!visitor(job))
+            {
+                return;
+            }
+
+            for (auto& dependent : job->m_dependents)
+            {
+                stack.push_back(dependent.get());
+            }
+        }
+    }
+
     template <typename CommonTaskFunc>
     sp<Job> Job::CreateCommon(CommonTaskFunc&& f)
     {
-        auto job = msp<Job>();
-        job->m_taskGroupId = std::hash<size_t>{}(reinterpret_cast<uintptr_t>(job.get()));
+        auto job = std::allocate_shared<Job>(JobAllocator<Job>());
         job->m_taskFunc = std::forward<CommonTaskFunc>(f);
 
         return job;
@@ -89,9 +219,8 @@ namespace dt
     template <typename ParallelTaskFunc>
     sp<Job> Job::CreateParallel(const uint32_t taskElemCount, ParallelTaskFunc&& f)
     {
-        auto job = msp<Job>();
+        auto job = std::allocate_shared<Job>(JobAllocator<Job>());
         job->m_taskElemCount = taskElemCount;
-        job->m_taskGroupId = std::hash<size_t>{}(reinterpret_cast<uintptr_t>(job.get()));
         job->m_parallelTaskFunc = std::forward<ParallelTaskFunc>(f);
 
         return job;
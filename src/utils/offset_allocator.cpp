@@ -0,0 +1,355 @@
+#include "offset_allocator.h"
+
+#include <cassert>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace dt
+{
+    namespace
+    {
+        uint32_t FindLowestBit(const uint64_t mask)
+        {
+#ifdef _MSC_VER
+            unsigned long index;
+            _BitScanForward64(&index, mask);
+            return index;
+#else
+            return __builtin_ctzll(mask);
+#endif
+        }
+
+        uint32_t FindHighestBit(const uint64_t mask)
+        {
+#ifdef _MSC_VER
+            unsigned long index;
+            _BitScanReverse64(&index, mask);
+            return index;
+#else
+            return 63 - __builtin_clzll(mask);
+#endif
+        }
+    }
+
+    OffsetAllocator::OffsetAllocator(const size_t capacityB)
+    {
+        for (auto& bin : m_bins)
+        {
+            bin = INVALID_NODE;
+        }
+
+        Grow(capacityB);
+    }
+
+    size_t OffsetAllocator::GetFragmentedSizeB() const
+    {
+        auto freeSizeB = m_capacityB - m_usedSizeB;
+        if (freeSizeB == 0 || m_nodes[m_lastNode].used)
+        {
+            return freeSizeB;
+        }
+
+        return freeSizeB - m_nodes[m_lastNode].sizeB;
+    }
+
+    uint32_t OffsetAllocator::Alloc(const size_t sizeB, const uint32_t userData)
+    {
+        assert(sizeB > 0);
+
+        auto node = FindFree(sizeB);
+        if (node == INVALID_NODE)
+        {
+            // 向上取整后找不到时，大小刚好够的块可能还在同一个桶里
+            uint32_t fl, sl;
+            GetBin(sizeB, fl, sl);
+            for (auto n = m_bins[fl * SL_COUNT + sl]; n != INVALID_NODE; n = m_nodes[n].nextFree)
+            {
+                if (m_nodes[n].sizeB >= sizeB)
+                {
+                    node = n;
+                    break;
+                }
+            }
+
+            if (node == INVALID_NODE)
+            {
+                return INVALID_NODE;
+            }
+        }
+
+        return Take(node, sizeB, userData);
+    }
+
+    uint32_t OffsetAllocator::AllocBefore(const size_t sizeB, const size_t endOffsetB, const uint32_t userData)
+    {
+        assert(sizeB > 0);
+
+        uint32_t fl, sl;
+        GetBin(sizeB, fl, sl);
+        for (; fl < FL_COUNT; ++fl, sl = 0)
+        {
+            for (; sl < SL_COUNT; ++sl)
+            {
+                if ((m_slBitmaps[fl] & 1u << sl) == 0)
+                {
+                    continue;
+                }
+
+                for (auto node = m_bins[fl * SL_COUNT + sl]; node != INVALID_NODE; node = m_nodes[node].nextFree)
+                {
+                    if (m_nodes[node].sizeB >= sizeB && m_nodes[node].offsetB + sizeB <= endOffsetB)
+                    {
+                        return Take(node, sizeB, userData);
+                    }
+                }
+            }
+        }
+
+        return INVALID_NODE;
+    }
+
+    uint32_t OffsetAllocator::Take(const uint32_t node, const size_t sizeB, const uint32_t userData)
+    {
+        RemoveFree(node);
+
+        if (m_nodes[node].sizeB > sizeB)
+        {
+            auto rest = CreateNode(m_nodes[node].offsetB + sizeB, m_nodes[node].sizeB - sizeB);
+            auto next = m_nodes[node].nextPhys;
+
+            m_nodes[rest].prevPhys = node;
+            m_nodes[rest].nextPhys = next;
+            if (next != INVALID_NODE)
+            {
+                m_nodes[next].prevPhys = rest;
+            }
+            else
+            {
+                m_lastNode = rest;
+            }
+
+            m_nodes[node].nextPhys = rest;
+            m_nodes[node].sizeB = sizeB;
+
+            InsertFree(rest);
+        }
+
+        m_nodes[node].used = true;
+        m_nodes[node].userData = userData;
+        m_usedSizeB += sizeB;
+
+        return node;
+    }
+
+    void OffsetAllocator::Free(uint32_t node)
+    {
+        assert(node < m_nodes.size() && m_nodes[node].used);
+
+        m_usedSizeB -= m_nodes[node].sizeB;
+        m_nodes[node].used = false;
+
+        auto prev = m_nodes[node].prevPhys;
+        if (prev != INVALID_NODE && !m_nodes[prev].used)
+        {
+            RemoveFree(prev);
+
+            auto next = m_nodes[node].nextPhys;
+            m_nodes[prev].sizeB += m_nodes[node].sizeB;
+            m_nodes[prev].nextPhys = next;
+            if (next != INVALID_NODE)
+            {
+                m_nodes[next].prevPhys = prev;
+            }
+            else
+            {
+                m_lastNode = prev;
+            }
+
+            ReleaseNode(node);
+            node = prev;
+        }
+
+        auto next = m_nodes[node].nextPhys;
+        if (next != INVALID_NODE && !m_nodes[next].used)
+        {
+            RemoveFree(next);
+
+            auto nextNext = m_nodes[next].nextPhys;
+            m_nodes[node].sizeB += m_nodes[next].sizeB;
+            m_nodes[node].nextPhys = nextNext;
+            if (nextNext != INVALID_NODE)
+            {
+                m_nodes[nextNext].prevPhys = node;
+            }
+            else
+            {
+                m_lastNode = node;
+            }
+
+            ReleaseNode(next);
+        }
+
+        InsertFree(node);
+    }
+
+    void OffsetAllocator::Grow(const size_t capacityB)
+    {
+        assert(capacityB >= m_capacityB);
+
+        if (capacityB == m_capacityB)
+        {
+            return;
+        }
+
+        auto addSizeB = capacityB - m_capacityB;
+        if (m_lastNode != INVALID_NODE && !m_nodes[m_lastNode].used)
+        {
+            RemoveFree(m_lastNode);
+            m_nodes[m_lastNode].sizeB += addSizeB;
+            InsertFree(m_lastNode);
+        }
+        else
+        {
+            auto node = CreateNode(m_capacityB, addSizeB);
+            m_nodes[node].prevPhys = m_lastNode;
+            if (m_lastNode != INVALID_NODE)
+            {
+                m_nodes[m_lastNode].nextPhys = node;
+            }
+            m_lastNode = node;
+
+            InsertFree(node);
+        }
+
+        m_capacityB = capacityB;
+    }
+
+    uint32_t OffsetAllocator::CreateNode(const size_t offsetB, const size_t sizeB)
+    {
+        uint32_t node;
+        if (!m_unusedNodes.empty())
+        {
+            node = m_unusedNodes.back();
+            m_unusedNodes.pop_back();
+        }
+        else
+        {
+            node = static_cast<uint32_t>(m_nodes.size());
+            m_nodes.emplace_back();
+        }
+
+        auto& n = m_nodes[node];
+        n.offsetB = offsetB;
+        n.sizeB = sizeB;
+        n.userData = 0;
+        n.used = false;
+        n.prevPhys = INVALID_NODE;
+        n.nextPhys = INVALID_NODE;
+        n.prevFree = INVALID_NODE;
+        n.nextFree = INVALID_NODE;
+
+        return node;
+    }
+
+    void OffsetAllocator::ReleaseNode(const uint32_t node)
+    {
+        m_unusedNodes.push_back(node);
+    }
+
+    void OffsetAllocator::InsertFree(const uint32_t node)
+    {
+        uint32_t fl, sl;
+        GetBin(m_nodes[node].sizeB, fl, sl);
+
+        auto& head = m_bins[fl * SL_COUNT + sl];
+        m_nodes[node].prevFree = INVALID_NODE;
+        m_nodes[node].nextFree = head;
+        if (head != INVALID_NODE)
+        {
+            m_nodes[head].prevFree = node;
+        }
+        head = node;
+
+        m_flBitmap |= 1ull << fl;
+        m_slBitmaps[fl] |= 1u << sl;
+    }
+
+    void OffsetAllocator::RemoveFree(const uint32_t node)
+    {
+        uint32_t fl, sl;
+        GetBin(m_nodes[node].sizeB, fl, sl);
+
+        auto prev = m_nodes[node].prevFree;
+        auto next = m_nodes[node].nextFree;
+        if (prev != INVALID_NODE)
+        {
+            m_nodes[prev].nextFree = next;
+        }
+        if (next != INVALID_NODE)
+        {
+            m_nodes[next].prevFree = prev;
+        }
+
+        auto& head = m_bins[fl * SL_COUNT + sl];
+        if (head == node)
+        {
+            head = next;
+            if (head == INVALID_NODE)
+            {
+                m_slBitmaps[fl] &= ~(1u << sl);
+                if (m_slBitmaps[fl] == 0)
+                {
+                    m_flBitmap &= ~(1ull << fl);
+                }
+            }
+        }
+    }
+
+    uint32_t OffsetAllocator::FindFree(const size_t sizeB) const
+    {
+        // 向上取整到下一个桶的起点，这样找到的桶里任意一个块都足够大
+        auto searchSizeB = sizeB;
+        if (sizeB >= SL_COUNT)
+        {
+            searchSizeB += (static_cast<size_t>(1) << (FindHighestBit(sizeB) - SL_BITS)) - 1;
+        }
+
+        uint32_t fl, sl;
+        GetBin(searchSizeB, fl, sl);
+        if (fl >= FL_COUNT)
+        {
+            return INVALID_NODE;
+        }
+
+        auto slMask = m_slBitmaps[fl] & (~0u << sl);
+        if (slMask == 0)
+        {
+            auto flMask = m_flBitmap & (~0ull << (fl + 1));
+            if (flMask == 0)
+            {
+                return INVALID_NODE;
+            }
+
+            fl = FindLowestBit(flMask);
+            slMask = m_slBitmaps[fl];
+        }
+
+        sl = FindLowestBit(slMask);
+        return m_bins[fl * SL_COUNT + sl];
+    }
+
+    void OffsetAllocator::GetBin(const size_t sizeB, uint32_t& fl, uint32_t& sl)
+    {
+        if (sizeB < SL_COUNT)
+        {
+            fl = 0;
+            sl = static_cast<uint32_t>(sizeB);
+            return;
+        }
+
+        auto highestBit = FindHighestBit(sizeB);
+        fl = highestBit - SL_BITS + 1;
+        sl = static_cast<uint32_t>(sizeB >> (highestBit - SL_BITS)) & (SL_COUNT - 1);
+    }
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+
+#include "common/const.h"
+
+namespace dt
+{
+    // 只管理偏移的TLSF分配器，不持有实际内存，用于在GPU buffer等外部内存里分配区间
+    // 空闲块按大小分到FL_COUNT * SL_COUNT个桶里，用位图找到第一个足够大的非空桶，分配和释放都是O(1)
+    // 释放时和物理上相邻的空闲块合并
+    class OffsetAllocator
+    {
+    public:
+        static constexpr uint32_t INVALID_NODE = UINT32_MAX;
+
+        explicit OffsetAllocator(size_t capacityB = 0);
+        OffsetAllocator(const OffsetAllocator& other) = delete;
+        OffsetAllocator(OffsetAllocator&& other) noexcept = delete;
+        OffsetAllocator& operator=(const OffsetAllocator& other) = delete;
+        OffsetAllocator& operator=(OffsetAllocator&& other) noexcept = delete;
+
+        size_t GetCapacity() const { return m_capacityB; }
+        size_t GetUsedSizeB() const { return m_usedSizeB; }
+
+        size_t GetOffset(const uint32_t node) const { return m_nodes[node].offsetB; }
+        size_t GetSize(const uint32_t node) const { return m_nodes[node].sizeB; }
+        uint32_t GetUserData(const uint32_t node) const { return m_nodes[node].userData; }
+        bool IsUsed(const uint32_t node) const { return m_nodes[node].used; }
+
+        // 物理上的最后一个块和前一个块，用于从后往前遍历
+        uint32_t GetLastNode() const { return m_lastNode; }
+        uint32_t GetPrevNode(const uint32_t node) const { return m_nodes[node].prevPhys; }
+
+        // 不在末尾的空闲空间，也就是整理碎片能回收的大小
+        size_t GetFragmentedSizeB() const;
+        // 空闲空间是否都在末尾连成一块
+        bool IsCompact() const { return GetFragmentedSizeB() == 0; }
+
+        // 没有足够大的空闲块时返回INVALID_NODE
+        uint32_t Alloc(size_t sizeB, uint32_t userData = 0);
+        // 只在endOffsetB之前找空闲块，需要遍历空闲链表，只用于整理碎片这类不频繁的操作
+        uint32_t AllocBefore(size_t sizeB, size_t endOffsetB, uint32_t userData = 0);
+        void Free(uint32_t node);
+        // 在末尾追加空闲空间，只能增大
+        void Grow(size_t capacityB);
+
+    private:
+        static constexpr uint32_t SL_BITS = 3;
+        static constexpr uint32_t SL_COUNT = 1 << SL_BITS;
+        static constexpr uint32_t FL_COUNT = 48;
+
+        struct Node
+        {
+            size_t offsetB;
+            size_t sizeB;
+            uint32_t userData;
+            bool used;
+
+            uint32_t prevPhys;
+            uint32_t nextPhys;
+            uint32_t prevFree;
+            uint32_t nextFree;
+        };
+
+        size_t m_capacityB = 0;
+        size_t m_usedSizeB = 0;
+
+        vec<Node> m_nodes;
+        vec<uint32_t> m_unusedNodes;
+        uint32_t m_lastNode = INVALID_NODE;
+
+        uint64_t m_flBitmap = 0;
+        uint32_t m_slBitmaps[FL_COUNT] = {};
+        uint32_t m_bins[FL_COUNT * SL_COUNT];
+
+        uint32_t CreateNode(size_t offsetB, size_t sizeB);
+        void ReleaseNode(uint32_t node);
+        uint32_t Take(uint32_t node, size_t sizeB, uint32_t userData);
+
+        void InsertFree(uint32_t node);
+        void RemoveFree(uint32_t node);
+        uint32_t FindFree(size_t sizeB) const;
+
+        static void GetBin(size_t sizeB, uint32_t& fl, uint32_t& sl);
+    };
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+
+#include "common/const.h"
+
+namespace dt
+{
+    // 按起点排序、互不重叠的区间集合，加入区间时和间隔不超过mergeGapB的区间合并
+    // 合并后多出的间隔也算在区间里，用更多的字节换更少的区间
+    class RangeSet
+    {
+    public:
+        struct Range
+        {
+            size_t offsetB;
+            size_t sizeB;
+        };
+
+        explicit RangeSet(const size_t mergeGapB = 0) : m_mergeGapB(mergeGapB) {}
+
+        crvec<Range> GetRanges() const { return m_ranges; }
+        bool Empty() const { return m_ranges.empty(); }
+        size_t GetSizeB() const;
+
+        void Add(size_t offsetB, size_t sizeB);
+        void Clear() { m_ranges.clear(); }
+
+    private:
+        size_t m_mergeGapB;
+        vec<Range> m_ranges;
+    };
+
+    inline size_t RangeSet::GetSizeB() const
+    {
+        size_t sizeB = 0;
+        for (auto& range : m_ranges)
+        {
+            sizeB += range.sizeB;
+        }
+
+        return sizeB;
+    }
+
+    inline void RangeSet::Add(const size_t offsetB, const size_t sizeB)
+    {
+        if (sizeB == 0)
+        {
+            return;
+        }
+
+        auto begin = offsetB;
+        auto end = offsetB + sizeB;
+
+        // 第一个结束位置加上间隔后能碰到新区间的区间
+        auto first = std::lower_bound(m_ranges.begin(), m_ranges.end(), begin, [this](cr<Range> range, const size_t b)
+        {
+            return range.offsetB + range.sizeB + m_mergeGapB < b;
+        });
+
+        auto last = first;
+        while (last != m_ranges.end() && last->offsetB <= end + m_mergeGapB)
+        {
+            begin = (std::min)(begin, last->offsetB);
+            end = (std::max)(end, last->offsetB + last->sizeB);
+            ++last;
+        }
+
+        if (first == last)
+        {
+            m_ranges.insert(first, { begin, end - begin });
+        }
+        else
+        {
+            *first = { begin, end - begin };
+            m_ranges.erase(first + 1, last);
+        }
+    }
+}
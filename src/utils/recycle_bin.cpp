@@ -0,0 +1,109 @@
+#include "recycle_bin.h"
+
+#include <tracy/Tracy.hpp>
+
+#include "utils/job_scheduler.h"
+
+namespace dt
+{
+    RecycleBin::~RecycleBin()
+    {
+        DeleteAll();
+    }
+
+    void RecycleBin::Flush()
+    {
+        ZoneScoped;
+
+        // 程序结束时后台线程已经停止，直接删除全部
+        if (!GR() || !GR()->jobScheduler)
+        {
+            DeleteAll();
+            return;
+        }
+
+        auto curFrame = GR()->GetFrameCount();
+        if (curFrame <= 1) // 在程序开始到Game::Update之间的资源是第0帧的，会在第1帧的Render中使用，而第1帧会清除第0帧的资源，所以跳过这次清理
+        {
+            return;
+        }
+
+        // 之后的Add进入当前帧的桶，交换出上次Flush到上一帧为止的桶，跳过的帧再多也最多BUCKET_COUNT - 1个桶
+        m_curFrame.store(curFrame, std::memory_order_release);
+
+        auto firstFrame = curFrame >= BUCKET_COUNT ? (std::max)(m_flushedFrame, curFrame - BUCKET_COUNT + 1) : m_flushedFrame;
+        m_flushedFrame = curFrame;
+
+        auto hasGarbage = false;
+        for (auto frame = firstFrame; frame < curFrame; ++frame)
+        {
+            if (auto list = m_buckets[frame % BUCKET_COUNT].exchange(nullptr, std::memory_order_acquire))
+            {
+                std::lock_guard lock(m_deleteMutex);
+                m_deleteLists.push_back(list);
+                hasGarbage = true;
+            }
+        }
+
+        if (hasGarbage && !m_deleteScheduled.exchange(true, std::memory_order_acq_rel))
+        {
+            GR()->jobScheduler->RunBackground([this] { return DeleteBackground(); });
+        }
+    }
+
+    bool RecycleBin::DeleteBackground()
+    {
+        ZoneScoped;
+
+        if (!m_deleting)
+        {
+            std::lock_guard lock(m_deleteMutex);
+            if (m_deleteLists.empty())
+            {
+                // 在锁里清除标记，之后Flush加入的链表会重新提交任务
+                m_deleteScheduled.store(false, std::memory_order_release);
+                return false;
+            }
+
+            m_deleting = m_deleteLists.back();
+            m_deleteLists.pop_back();
+        }
+
+        // 每次只删除一批，剩下的由线程池按后台预算继续执行
+        for (uint32_t i = 0; i < DELETE_BATCH_SIZE && m_deleting; ++i)
+        {
+            auto next = m_deleting->m_nextGarbage;
+            delete m_deleting;
+            m_deleting = next;
+        }
+
+        return true;
+    }
+
+    void RecycleBin::DeleteAll()
+    {
+        DeleteList(m_deleting);
+        m_deleting = nullptr;
+
+        for (auto list : m_deleteLists)
+        {
+            DeleteList(list);
+        }
+        m_deleteLists.clear();
+
+        for (auto& bucket : m_buckets)
+        {
+            DeleteList(bucket.exchange(nullptr, std::memory_order_acquire));
+        }
+    }
+
+    void RecycleBin::DeleteList(IRecyclable* list)
+    {
+        while (list)
+        {
+            auto next = list->m_nextGarbage;
+            delete list;
+            list = next;
+        }
+    }
+}
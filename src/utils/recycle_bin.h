@@ -1,4 +1,6 @@
 ﻿#pragma once
+#include <atomic>
+
 #include "common/utils.h"
 #include "game/game_resource.h"
 
@@ -13,66 +15,77 @@ namespace dt
         IRecyclable(IRecyclable&& other) noexcept = delete;
         IRecyclable& operator=(const IRecyclable& other) = delete;
         IRecyclable& operator=(IRecyclable&& other) noexcept = delete;
+
+    private:
+        // 进入RecycleBin后串成单链表，不需要额外分配
+        IRecyclable* m_nextGarbage = nullptr;
+
+        friend class RecycleBin;
     };
     
+    // 释放时按当前帧号放进固定数量的桶里，等渲染线程执行完那一帧后再删除
+    // Add是无锁的，可以在任意线程调用；Flush每帧只交换出已完成帧的桶，实际的删除交给后台任务分批执行
     class RecycleBin : public Singleton<RecycleBin>
     {
     public:
-        void Add(IRecyclable* garbage, uint32_t frameCount);
-        void Flush();
+        static constexpr uint32_t BUCKET_COUNT = 4;
+        static constexpr uint32_t DELETE_BATCH_SIZE = 64;
 
-    private:
-        std::mutex m_mutex;
-        vec<IRecyclable*> m_pending;
-        umap<uint32_t, vec<IRecyclable*>> m_garbage;
-    };
+        RecycleBin() = default;
+        ~RecycleBin();
+        RecycleBin(const RecycleBin& other) = delete;
+        RecycleBin(RecycleBin&& other) noexcept = delete;
+        RecycleBin& operator=(const RecycleBin& other) = delete;
+        RecycleBin& operator=(RecycleBin&& other) noexcept = delete;
 
-    inline void RecycleBin::Add(IRecyclable* garbage, const uint32_t frameCount)
-    {
-        std::lock_guard lock(m_mutex);
-        m_garbage[frameCount].push_back(garbage);
-    }
+        void Add(IRecyclable* garbage);
+        // 渲染线程执行完上一帧的命令后调用，可以在任意线程，但同一时间只能有一个调用
+        void Flush();
 
-    inline void RecycleBin::Flush()
-    {
-        std::lock_guard lock(m_mutex);
+    private:
+        std::atomic<IRecyclable*> m_buckets[BUCKET_COUNT] = {};
+        std::atomic<uint64_t> m_curFrame = 0;
+        // 小于这一帧的桶都已经交换出去了
+        uint64_t m_flushedFrame = 0;
 
-        auto curFrame = GR() ? GR()->GetFrameCount() : ~0u;
-        if (curFrame <= 1) // 在程序开始到Game::Update之间的资源是第0帧的，会在第1帧的Render中使用，而第1帧会清除第0帧的资源，所以跳过这次清理
-        {
-            return;
-        }
+        std::mutex m_deleteMutex;
+        vec<IRecyclable*> m_deleteLists;
+        std::atomic<bool> m_deleteScheduled = false;
+        // 只由后台任务访问
+        IRecyclable* m_deleting = nullptr;
 
-        vec<decltype(m_garbage)::iterator> eraseGarbage;
-        for (auto it = m_garbage.begin(); it != m_garbage.end(); ++it)
-        {
-            auto [frameCount, garbage] = *it;
-            if (frameCount < curFrame)
-            {
-                for (auto ptr : garbage)
-                {
-                    delete ptr;
-                }
+        bool DeleteBackground();
+        void DeleteAll();
 
-                eraseGarbage.push_back(it);
-            }
-        }
+        static void DeleteList(IRecyclable* list);
+    };
 
-        for (auto it : eraseGarbage)
+    inline void RecycleBin::Add(IRecyclable* garbage)
+    {
+        // 读到旧帧号时只会晚几帧删除，不会提前
+        auto& bucket = m_buckets[m_curFrame.load(std::memory_order_acquire) % BUCKET_COUNT];
+        auto head = bucket.load(std::memory_order_relaxed);
+        do
         {
-            m_garbage.erase(it);
+            garbage->m_nextGarbage = head;
         }
+        while (!bucket.compare_exchange_weak(head, garbage, std::memory_order_release, std::memory_order_relaxed));
     }
     
     template<typename T>
     static std::shared_ptr<T> set_recyclable(T* rawPtr)
     {
-        assert(Utils::IsMainThread());
-        
-        auto curFrame = GR() ? GR()->GetFrameCount() : 0;
-        return std::shared_ptr<T>(rawPtr, [curFrame](T* ptr)
+        // 最后一个引用可以在任意线程释放
+        return std::shared_ptr<T>(rawPtr, [](T* ptr)
         {
-            RecycleBin::Ins()->Add(static_cast<IRecyclable*>(ptr), curFrame);
+            if (auto recycleBin = RecycleBin::Ins())
+            {
+                recycleBin->Add(static_cast<IRecyclable*>(ptr));
+            }
+            else
+            {
+                delete ptr;
+            }
         });
     }
 
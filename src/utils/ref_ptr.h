@@ -0,0 +1,158 @@
+#pragma once
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace dt
+{
+    // 侵入式的非原子引用计数，只能在创建对象的线程上增减引用，拷贝时没有shared_ptr的原子操作
+    // 不要把RefPtr捕获进渲染命令，渲染命令会在渲染线程析构；用RenderThread::HandOff让主线程持有到命令执行完，命令里只用裸指针
+    class RefCounted
+    {
+    public:
+        RefCounted() = default;
+        virtual ~RefCounted() = default;
+        RefCounted(const RefCounted& other) = delete;
+        RefCounted(RefCounted&& other) noexcept = delete;
+        RefCounted& operator=(const RefCounted& other) = delete;
+        RefCounted& operator=(RefCounted&& other) noexcept = delete;
+
+        uint32_t GetRefCount() const { return m_refCount; }
+
+    private:
+        uint32_t m_refCount = 0;
+#ifndef NDEBUG
+        uint32_t m_ownerThread = GetThreadIndex();
+
+        // 线程编号缓存在线程局部变量里，比每次比较std::thread::id便宜，调试版的准备阶段也不会明显变慢
+        static uint32_t GetThreadIndex();
+#endif
+
+        void AddRef();
+        void Release();
+
+        template <typename T>
+        friend class RefPtr;
+    };
+
+    template <typename T>
+    class RefPtr
+    {
+    public:
+        RefPtr() = default;
+        RefPtr(std::nullptr_t) {}
+        // 接管裸指针，引用计数加一
+        explicit RefPtr(T* ptr);
+        RefPtr(const RefPtr& other) : RefPtr(other.m_ptr) {}
+        RefPtr(RefPtr&& other) noexcept : m_ptr(std::exchange(other.m_ptr, nullptr)) {}
+        template <typename U>
+        RefPtr(const RefPtr<U>& other) : RefPtr(other.Get()) {}
+        ~RefPtr() { Reset(); }
+
+        RefPtr& operator=(const RefPtr& other);
+        RefPtr& operator=(RefPtr&& other) noexcept;
+
+        T* Get() const { return m_ptr; }
+        T* operator->() const { assert(m_ptr); return m_ptr; }
+        T& operator*() const { assert(m_ptr); return *m_ptr; }
+        explicit operator bool() const { return m_ptr != nullptr; }
+
+        void Reset();
+
+        friend bool operator==(const RefPtr& lhs, const RefPtr& rhs) { return lhs.m_ptr == rhs.m_ptr; }
+        friend bool operator!=(const RefPtr& lhs, const RefPtr& rhs) { return lhs.m_ptr != rhs.m_ptr; }
+        friend bool operator==(const RefPtr& lhs, std::nullptr_t) { return lhs.m_ptr == nullptr; }
+        friend bool operator!=(const RefPtr& lhs, std::nullptr_t) { return lhs.m_ptr != nullptr; }
+
+    private:
+        T* m_ptr = nullptr;
+    };
+
+    template <typename T>
+    using rp = RefPtr<T>;
+    template <typename T>
+    using crrp = const RefPtr<T>&;
+    template <typename T>
+    using vecrp = std::vector<RefPtr<T>>;
+    template <typename T>
+    using crvecrp = const std::vector<RefPtr<T>>&;
+
+    template <typename T, typename... Args>
+    RefPtr<T> mrp(Args&&... args)
+    {
+        return RefPtr<T>(new T(std::forward<Args>(args)...));
+    }
+
+#ifndef NDEBUG
+    inline uint32_t RefCounted::GetThreadIndex()
+    {
+        // 都是常量初始化，访问时没有初始化检查
+        static std::atomic<uint32_t> s_threadCount = 0;
+        thread_local uint32_t threadIndex = 0;
+
+        if (threadIndex == 0)
+        {
+            threadIndex = s_threadCount.fetch_add(1, std::memory_order_relaxed) + 1;
+        }
+
+        return threadIndex;
+    }
+#endif
+
+    inline void RefCounted::AddRef()
+    {
+        assert(m_ownerThread == GetThreadIndex() && "RefCounted is used outside its owner thread");
+        ++m_refCount;
+    }
+
+    inline void RefCounted::Release()
+    {
+        assert(m_ownerThread == GetThreadIndex() && "RefCounted is used outside its owner thread");
+        assert(m_refCount > 0);
+
+        if (--m_refCount == 0)
+        {
+            delete this;
+        }
+    }
+
+    template <typename T>
+    RefPtr<T>::RefPtr(T* ptr) : m_ptr(ptr)
+    {
+        if (m_ptr)
+        {
+            static_cast<RefCounted*>(m_ptr)->AddRef();
+        }
+    }
+
+    template <typename T>
+    RefPtr<T>& RefPtr<T>::operator=(const RefPtr& other)
+    {
+        // 先加后减，自赋值时不会提前释放
+        RefPtr copy(other);
+        std::swap(m_ptr, copy.m_ptr);
+        return *this;
+    }
+
+    template <typename T>
+    RefPtr<T>& RefPtr<T>::operator=(RefPtr&& other) noexcept
+    {
+        if (this != &other)
+        {
+            Reset();
+            m_ptr = std::exchange(other.m_ptr, nullptr);
+        }
+        return *this;
+    }
+
+    template <typename T>
+    void RefPtr<T>::Reset()
+    {
+        if (auto ptr = std::exchange(m_ptr, nullptr))
+        {
+            static_cast<RefCounted*>(ptr)->Release();
+        }
+    }
+}
@@ -0,0 +1,122 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+namespace dt
+{
+    // 只管理偏移的环形线性分配器，用于每帧的上传内存
+    // 从m_tail往后分配，末尾放不下时跳过剩余部分从头开始；EndFrame把上次调用以来的分配记在栅栏值下
+    // Reclaim传入已经完成的栅栏值，按顺序回收这些帧占用的空间，栅栏值可以是帧号
+    class RingAllocator
+    {
+    public:
+        static constexpr size_t INVALID_OFFSET = SIZE_MAX;
+
+        explicit RingAllocator(const size_t capacityB) : m_capacityB(capacityB) {}
+
+        size_t GetCapacity() const { return m_capacityB; }
+        // 包含因为对齐和回绕跳过的部分
+        size_t GetUsedSizeB() const { return m_usedSizeB; }
+
+        // 空间不够时返回INVALID_OFFSET，alignment必须是2的幂
+        size_t Alloc(size_t sizeB, size_t alignment = 1);
+        void EndFrame(uint64_t fenceValue);
+        void Reclaim(uint64_t completedFenceValue);
+
+    private:
+        struct Frame
+        {
+            uint64_t fenceValue;
+            size_t endOffsetB;
+            size_t sizeB;
+        };
+
+        size_t m_capacityB;
+        size_t m_usedSizeB = 0;
+        size_t m_curFrameSizeB = 0;
+
+        // 最早还在使用的位置和下一次分配的位置
+        size_t m_head = 0;
+        size_t m_tail = 0;
+
+        std::deque<Frame> m_frames;
+    };
+
+    inline size_t RingAllocator::Alloc(const size_t sizeB, const size_t alignment)
+    {
+        assert(sizeB > 0 && (alignment & (alignment - 1)) == 0);
+
+        if (m_usedSizeB == m_capacityB)
+        {
+            return INVALID_OFFSET;
+        }
+
+        auto offsetB = (m_tail + alignment - 1) & ~(alignment - 1);
+        size_t newTail;
+        if (m_tail >= m_head)
+        {
+            // 空闲的是[tail, capacity)和[0, head)
+            if (offsetB + sizeB <= m_capacityB)
+            {
+                newTail = offsetB + sizeB;
+            }
+            else if (sizeB <= m_head)
+            {
+                offsetB = 0;
+                newTail = sizeB;
+            }
+            else
+            {
+                return INVALID_OFFSET;
+            }
+        }
+        else
+        {
+            // 空闲的是[tail, head)
+            if (offsetB + sizeB > m_head)
+            {
+                return INVALID_OFFSET;
+            }
+            newTail = offsetB + sizeB;
+        }
+
+        auto consumedB = newTail >= m_tail ? newTail - m_tail : m_capacityB - m_tail + newTail;
+        m_usedSizeB += consumedB;
+        m_curFrameSizeB += consumedB;
+        m_tail = newTail;
+
+        return offsetB;
+    }
+
+    inline void RingAllocator::EndFrame(const uint64_t fenceValue)
+    {
+        if (m_curFrameSizeB == 0)
+        {
+            return;
+        }
+
+        assert(m_frames.empty() || m_frames.back().fenceValue <= fenceValue);
+
+        m_frames.push_back({ fenceValue, m_tail, m_curFrameSizeB });
+        m_curFrameSizeB = 0;
+    }
+
+    inline void RingAllocator::Reclaim(const uint64_t completedFenceValue)
+    {
+        while (!m_frames.empty() && m_frames.front().fenceValue <= completedFenceValue)
+        {
+            m_head = m_frames.front().endOffsetB;
+            m_usedSizeB -= m_frames.front().sizeB;
+            m_frames.pop_front();
+        }
+
+        // 全部空闲时回到开头，减少回绕
+        if (m_usedSizeB == 0)
+        {
+            m_head = 0;
+            m_tail = 0;
+        }
+    }
+}
@@ -183,8 +183,10 @@ namespace dt
         if (m_data)
         {
             Release(m_data);
+            m_data = nullptr;
         }
         
+        m_alignment = other.m_alignment;
         auto otherSize = other.Size();
         if (other.m_capacity != 0)
         {
@@ -201,8 +203,12 @@ namespace dt
     template <typename T>
     void SimpleList<T>::StealFrom(SimpleList& other)
     {
-        assert(m_alignment == other.m_alignment);
+        if (m_data)
+        {
+            Release(m_data);
+        }
         
+        m_alignment = other.m_alignment;
         m_data = other.m_data;
         m_back = other.m_back;
         m_capacity = other.m_capacity;
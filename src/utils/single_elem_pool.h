@@ -6,26 +6,47 @@
 
 namespace dt
 {
+    // 固定容量的池，空闲槽位串成双向链表，分配和释放都是O(1)
+    // Id带有代数，槽位释放后旧的Id失效，Handle是可选的RAII包装，按值持有，析构时释放槽位
     template <typename T>
     class SingleElemPool
     {
     public:
-        struct Handle
+        static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+        struct Id
+        {
+            uint32_t index = INVALID_INDEX;
+            uint32_t generation = 0;
+
+            bool operator==(const Id& other) const { return index == other.index && generation == other.generation; }
+            bool operator!=(const Id& other) const { return !(*this == other); }
+        };
+
+        class Handle
         {
+        public:
             Handle() = default;
             ~Handle();
             Handle(const Handle& other) = delete;
-            Handle(Handle&& other) noexcept = delete;
+            Handle(Handle&& other) noexcept;
             Handle& operator=(const Handle& other) = delete;
-            Handle& operator=(Handle&& other) noexcept = delete;
-            
-            uint32_t GetIndex() const { return m_index; }
-            
-            T data;
+            Handle& operator=(Handle&& other) noexcept;
+
+            explicit operator bool() const { return m_pool != nullptr; }
+            uint32_t GetIndex() const { return m_id.index; }
+            Id GetId() const { return m_id; }
+            // 槽位数组不会扩容，直接记录数据地址，渲染线程读取时不需要访问池的状态
+            T& GetData() const { return *m_data; }
+
+            void Reset();
 
         private:
-            uint32_t m_index;
-            SingleElemPool* m_pool;
+            SingleElemPool* m_pool = nullptr;
+            Id m_id;
+            T* m_data = nullptr;
+
+            Handle(SingleElemPool* pool, Id id);
 
             friend class SingleElemPool;
         };
@@ -37,45 +58,97 @@ namespace dt
         SingleElemPool& operator=(const SingleElemPool& other) = delete;
         SingleElemPool& operator=(SingleElemPool&& other) noexcept = delete;
 
-        sp<Handle> Alloc(bool append = false);
+        uint32_t GetCapacity() const { return static_cast<uint32_t>(m_slots.size()); }
+        uint32_t GetCount() const { return m_count; }
+
+        // append为true时分配在所有已用槽位之后，连续调用得到的index是连续的
+        Id Alloc(bool append = false);
+        void Free(Id id);
+        bool IsValid(Id id) const;
+        T& Get(Id id);
+        const T& Get(Id id) const;
 
-        template <typename F>
-        sp<Handle> Find(F&& predicate);
+        Handle AllocHandle(bool append = false);
 
     private:
-        struct Elem
+        struct Slot
         {
-            wp<Handle> handle;
-            uint32_t index;
+            T data;
+            uint32_t generation = 0;
+            uint32_t prevFree = INVALID_INDEX;
+            uint32_t nextFree = INVALID_INDEX;
+            bool used = false;
         };
-        
-        void Release(const Handle* handle);
-        
-        vec<Elem> m_data;
-        uint32_t m_capacity;
+
+        vec<Slot> m_slots;
         uint32_t m_count = 0;
         uint32_t m_size = 0;
-        uint32_t m_firstFreeIndex = 0;
+        uint32_t m_freeHead = INVALID_INDEX;
+
+        void PushFree(uint32_t index);
+        void RemoveFree(uint32_t index);
     };
 
+    template <typename T>
+    SingleElemPool<T>::Handle::Handle(SingleElemPool* pool, const Id id)
+    {
+        m_pool = pool;
+        m_id = id;
+        m_data = &pool->Get(id);
+    }
+
     template <typename T>
     SingleElemPool<T>::Handle::~Handle()
     {
-        m_pool->Release(this);
+        Reset();
     }
 
     template <typename T>
-    SingleElemPool<T>::SingleElemPool(const uint32_t capacity)
+    SingleElemPool<T>::Handle::Handle(Handle&& other) noexcept
     {
-        assert(capacity > 0);
-        
-        m_data = vec<Elem>(capacity);
-        for (uint32_t i = 0; i < capacity; ++i)
+        m_pool = other.m_pool;
+        m_id = other.m_id;
+        m_data = other.m_data;
+        other.m_pool = nullptr;
+        other.m_id = {};
+        other.m_data = nullptr;
+    }
+
+    template <typename T>
+    typename SingleElemPool<T>::Handle& SingleElemPool<T>::Handle::operator=(Handle&& other) noexcept
+    {
+        if (this != &other)
         {
-            m_data[i].index = i;
+            Reset();
+            m_pool = other.m_pool;
+            m_id = other.m_id;
+            m_data = other.m_data;
+            other.m_pool = nullptr;
+            other.m_id = {};
+            other.m_data = nullptr;
         }
+
+        return *this;
+    }
+
+    template <typename T>
+    void SingleElemPool<T>::Handle::Reset()
+    {
+        if (m_pool)
+        {
+            m_pool->Free(m_id);
+            m_pool = nullptr;
+            m_id = {};
+            m_data = nullptr;
+        }
+    }
+
+    template <typename T>
+    SingleElemPool<T>::SingleElemPool(const uint32_t capacity)
+    {
+        assert(capacity > 0 && capacity < INVALID_INDEX);
         
-        m_capacity = capacity;
+        m_slots = vec<Slot>(capacity);
     }
 
     template <typename T>
@@ -85,62 +158,118 @@ namespace dt
     }
 
     template <typename T>
-    sp<typename SingleElemPool<T>::Handle> SingleElemPool<T>::Alloc(const bool append)
+    typename SingleElemPool<T>::Id SingleElemPool<T>::Alloc(const bool append)
     {
-        auto searchStart = append ? m_size : m_firstFreeIndex;
-        
-        for (uint32_t i = searchStart; i < m_capacity; ++i)
+        uint32_t index;
+        if (!append && m_freeHead != INVALID_INDEX)
         {
-            if (!m_data[i].handle.expired())
+            index = m_freeHead;
+            RemoveFree(index);
+        }
+        else
+        {
+            // 空闲链表里只有m_size以内的槽位，m_size之后的槽位都是空闲的
+            if (m_size >= GetCapacity())
             {
-                continue;
+                THROW_ERROR("Out of space")
             }
+            index = m_size++;
+        }
+
+        auto& slot = m_slots[index];
+        assert(!slot.used);
+        slot.used = true;
+        ++m_count;
+
+        return { index, slot.generation };
+    }
 
-            auto handle = msp<Handle>();
-            handle->m_index = i;
-            handle->m_pool = this;
+    template <typename T>
+    void SingleElemPool<T>::Free(const Id id)
+    {
+        assert(IsValid(id));
+
+        auto& slot = m_slots[id.index];
+        slot.used = false;
+        ++slot.generation;
+        --m_count;
 
-            m_data[i].handle = handle;
-            m_firstFreeIndex = i + 1;
-            ++m_count;
-            m_size = (std::max)(i + 1, m_size);
-            
-            return handle;
+        if (id.index + 1 != m_size)
+        {
+            PushFree(id.index);
+            return;
         }
 
-        THROW_ERROR("Out of space")
+        // 释放的是最后一个槽位时收缩m_size，让append分配可以复用尾部
+        --m_size;
+        while (m_size > 0 && !m_slots[m_size - 1].used)
+        {
+            RemoveFree(m_size - 1);
+            --m_size;
+        }
     }
 
     template <typename T>
-    void SingleElemPool<T>::Release(const Handle* handle)
+    bool SingleElemPool<T>::IsValid(const Id id) const
     {
-        auto index = handle->m_index;
-        assert(index < m_capacity);
+        return id.index < m_size && m_slots[id.index].used && m_slots[id.index].generation == id.generation;
+    }
 
-        auto& elem = m_data[index];
+    template <typename T>
+    T& SingleElemPool<T>::Get(const Id id)
+    {
+        assert(IsValid(id));
 
-        m_firstFreeIndex = (std::min)(m_firstFreeIndex, index);
-        --m_count;
+        return m_slots[id.index].data;
+    }
 
-        while (m_size > 0 && m_data[m_size - 1].handle.expired())
+    template <typename T>
+    const T& SingleElemPool<T>::Get(const Id id) const
+    {
+        assert(IsValid(id));
+
+        return m_slots[id.index].data;
+    }
+
+    template <typename T>
+    typename SingleElemPool<T>::Handle SingleElemPool<T>::AllocHandle(const bool append)
+    {
+        return Handle(this, Alloc(append));
+    }
+
+    template <typename T>
+    void SingleElemPool<T>::PushFree(const uint32_t index)
+    {
+        auto& slot = m_slots[index];
+        slot.prevFree = INVALID_INDEX;
+        slot.nextFree = m_freeHead;
+        if (m_freeHead != INVALID_INDEX)
         {
-            --m_size;
+            m_slots[m_freeHead].prevFree = index;
         }
+        m_freeHead = index;
     }
 
     template <typename T>
-    template <typename Predicate>
-    sp<typename SingleElemPool<T>::Handle> SingleElemPool<T>::Find(Predicate&& predicate)
+    void SingleElemPool<T>::RemoveFree(const uint32_t index)
     {
-        for (uint32_t i = 0; i < m_size; ++i)
+        auto& slot = m_slots[index];
+        if (slot.prevFree != INVALID_INDEX)
         {
-            auto& handle = m_data[i].handle;
-            if (!handle.expired() && predicate(handle.lock()))
-            {
-                return handle.lock();
-            }
+            m_slots[slot.prevFree].nextFree = slot.nextFree;
+        }
+        else
+        {
+            assert(m_freeHead == index);
+            m_freeHead = slot.nextFree;
+        }
+
+        if (slot.nextFree != INVALID_INDEX)
+        {
+            m_slots[slot.nextFree].prevFree = slot.prevFree;
         }
 
-        return nullptr;
+        slot.prevFree = INVALID_INDEX;
+        slot.nextFree = INVALID_INDEX;
     }
 }
@@ -0,0 +1,206 @@
+#pragma once
+#include <cassert>
+#include <cstdint>
+#include <tuple>
+#include <utility>
+
+#include "common/const.h"
+#include "utils/simple_list.h"
+
+namespace dt
+{
+    // 把结构体数组拆成每个字段一个对齐的连续数组，所有字段同步增删
+    // 容量始终补齐到SIMD_WIDTH的整数倍，可以按SIMD宽度整批读写到PaddedSize，补齐部分的内容无意义
+    // 每个元素有稳定的id，增删时元素的下标会变，通过id查找当前下标
+    template <typename... Fields>
+    class SoaList
+    {
+    public:
+        static constexpr uint32_t SIMD_WIDTH = 4;
+        static constexpr uint32_t ALIGNMENT = 64;
+        static constexpr uint32_t INVALID_ID = UINT32_MAX;
+
+        template <size_t I>
+        using Field = std::tuple_element_t<I, std::tuple<Fields...>>;
+
+        explicit SoaList(uint32_t capacity = 0);
+        SoaList(const SoaList& other) = delete;
+        SoaList(SoaList&& other) noexcept = delete;
+        SoaList& operator=(const SoaList& other) = delete;
+        SoaList& operator=(SoaList&& other) noexcept = delete;
+
+        uint32_t Size() const { return m_ids.Size(); }
+        uint32_t PaddedSize() const { return (Size() + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH; }
+        bool Empty() const { return m_ids.Empty(); }
+
+        template <size_t I>
+        Field<I>* Data() const { return std::get<I>(m_fields).Data(); }
+        template <size_t I>
+        Field<I>& Get(uint32_t index) { return std::get<I>(m_fields)[index]; }
+        template <size_t I>
+        const Field<I>& Get(uint32_t index) const { return std::get<I>(m_fields)[index]; }
+
+        bool Contains(uint32_t id) const { return id < m_idToIndex.size() && m_idToIndex[id] != INVALID_ID; }
+        uint32_t GetIndex(const uint32_t id) const { assert(Contains(id)); return m_idToIndex[id]; }
+        uint32_t GetId(const uint32_t index) const { assert(index < Size()); return m_ids[index]; }
+
+        uint32_t Add(const Fields&... values);
+        // 用最后一个元素填补空位，不保持顺序
+        void Remove(uint32_t id);
+        // 一次删除所有满足条件的元素，保持剩余元素的顺序，predicate的参数为下标
+        template <typename Predicate>
+        void RemoveIf(Predicate&& predicate);
+        void Reserve(uint32_t capacity);
+        void Clear();
+
+    private:
+        std::tuple<SimpleList<Fields>...> m_fields;
+        SimpleList<uint32_t> m_ids;
+        vec<uint32_t> m_idToIndex;
+        vec<uint32_t> m_freeIds;
+
+        void Move(uint32_t from, uint32_t to);
+        template <size_t... I>
+        void Append(std::index_sequence<I...>, const Fields&... values);
+        template <size_t... I>
+        void Move(std::index_sequence<I...>, uint32_t from, uint32_t to);
+        template <size_t... I>
+        void Resize(std::index_sequence<I...>, uint32_t size);
+        template <size_t... I>
+        void Reserve(std::index_sequence<I...>, uint32_t capacity);
+    };
+
+    template <typename... Fields>
+    SoaList<Fields...>::SoaList(const uint32_t capacity)
+        : m_fields(SimpleList<Fields>(0, ALIGNMENT)...), m_ids(0, ALIGNMENT)
+    {
+        Reserve(capacity);
+    }
+
+    template <typename... Fields>
+    uint32_t SoaList<Fields...>::Add(const Fields&... values)
+    {
+        auto index = Size();
+        Reserve(index + 1);
+
+        uint32_t id;
+        if (!m_freeIds.empty())
+        {
+            id = m_freeIds.back();
+            m_freeIds.pop_back();
+        }
+        else
+        {
+            id = static_cast<uint32_t>(m_idToIndex.size());
+            m_idToIndex.push_back(INVALID_ID);
+        }
+
+        Append(std::index_sequence_for<Fields...>(), values...);
+        m_ids.template Add<false>(id);
+        m_idToIndex[id] = index;
+
+        return id;
+    }
+
+    template <typename... Fields>
+    void SoaList<Fields...>::Remove(const uint32_t id)
+    {
+        auto index = GetIndex(id);
+        auto last = Size() - 1;
+        if (index != last)
+        {
+            Move(last, index);
+        }
+
+        Resize(std::index_sequence_for<Fields...>(), last);
+        m_ids.Resize(last);
+
+        m_idToIndex[id] = INVALID_ID;
+        m_freeIds.push_back(id);
+    }
+
+    template <typename... Fields>
+    template <typename Predicate>
+    void SoaList<Fields...>::RemoveIf(Predicate&& predicate)
+    {
+        uint32_t count = 0;
+        for (uint32_t i = 0; i < Size(); ++i)
+        {
+            if (predicate(i))
+            {
+                m_idToIndex[m_ids[i]] = INVALID_ID;
+                m_freeIds.push_back(m_ids[i]);
+                continue;
+            }
+
+            if (count != i)
+            {
+                Move(i, count);
+            }
+            ++count;
+        }
+
+        Resize(std::index_sequence_for<Fields...>(), count);
+        m_ids.Resize(count);
+    }
+
+    template <typename... Fields>
+    void SoaList<Fields...>::Reserve(const uint32_t capacity)
+    {
+        auto paddedCapacity = (capacity + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+        if (paddedCapacity <= m_ids.Capacity())
+        {
+            return;
+        }
+
+        auto newCapacity = (std::max)(paddedCapacity, m_ids.Capacity() * 2);
+        Reserve(std::index_sequence_for<Fields...>(), newCapacity);
+        m_ids.Reserve(newCapacity);
+    }
+
+    template <typename... Fields>
+    void SoaList<Fields...>::Clear()
+    {
+        Resize(std::index_sequence_for<Fields...>(), 0);
+        m_ids.Clear();
+        m_idToIndex.clear();
+        m_freeIds.clear();
+    }
+
+    template <typename... Fields>
+    void SoaList<Fields...>::Move(const uint32_t from, const uint32_t to)
+    {
+        Move(std::index_sequence_for<Fields...>(), from, to);
+
+        m_ids[to] = m_ids[from];
+        m_idToIndex[m_ids[to]] = to;
+    }
+
+    template <typename... Fields>
+    template <size_t... I>
+    void SoaList<Fields...>::Append(std::index_sequence<I...>, const Fields&... values)
+    {
+        (std::get<I>(m_fields).template Add<false>(values), ...);
+    }
+
+    template <typename... Fields>
+    template <size_t... I>
+    void SoaList<Fields...>::Move(std::index_sequence<I...>, const uint32_t from, const uint32_t to)
+    {
+        ((std::get<I>(m_fields)[to] = std::get<I>(m_fields)[from]), ...);
+    }
+
+    template <typename... Fields>
+    template <size_t... I>
+    void SoaList<Fields...>::Resize(std::index_sequence<I...>, const uint32_t size)
+    {
+        (std::get<I>(m_fields).Resize(size), ...);
+    }
+
+    template <typename... Fields>
+    template <size_t... I>
+    void SoaList<Fields...>::Reserve(std::index_sequence<I...>, const uint32_t capacity)
+    {
+        (std::get<I>(m_fields).Reserve(capacity), ...);
+    }
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+
+#include "common/const.h"
+
+namespace dt
+{
+    // 单生产者单消费者的无锁环形队列，容量固定，批量入队只发布一次写指针
+    template <typename T>
+    class SpscRing
+    {
+    public:
+        explicit SpscRing(uint32_t capacity);
+        SpscRing(const SpscRing& other) = delete;
+        SpscRing(SpscRing&& other) noexcept = delete;
+        SpscRing& operator=(const SpscRing& other) = delete;
+        SpscRing& operator=(SpscRing&& other) noexcept = delete;
+
+        uint32_t Capacity() const { return static_cast<uint32_t>(m_items.size()); }
+        bool Empty() const { return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire); }
+
+        uint32_t Push(const T* items, uint32_t count);
+        bool Pop(T& item);
+        void Clear();
+
+    private:
+        vec<T> m_items;
+        uint32_t m_mask;
+
+        alignas(64) std::atomic<uint32_t> m_head = 0;
+        alignas(64) std::atomic<uint32_t> m_tail = 0;
+    };
+
+    template <typename T>
+    SpscRing<T>::SpscRing(const uint32_t capacity)
+    {
+        assert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+
+        m_items.resize(capacity);
+        m_mask = capacity - 1;
+    }
+
+    template <typename T>
+    uint32_t SpscRing<T>::Push(const T* items, const uint32_t count)
+    {
+        auto tail = m_tail.load(std::memory_order_relaxed);
+        auto head = m_head.load(std::memory_order_acquire);
+        auto pushCount = (std::min)(count, Capacity() - (tail - head));
+
+        for (uint32_t i = 0; i < pushCount; ++i)
+        {
+            m_items[(tail + i) & m_mask] = items[i];
+        }
+
+        if (pushCount > 0)
+        {
+            m_tail.store(tail + pushCount, std::memory_order_release);
+        }
+
+        return pushCount;
+    }
+
+    template <typename T>
+    bool SpscRing<T>::Pop(T& item)
+    {
+        auto head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+
+        item = std::move(m_items[head & m_mask]);
+        m_head.store(head + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    template <typename T>
+    void SpscRing<T>::Clear()
+    {
+        T item;
+        while (Pop(item))
+        {
+        }
+    }
+}
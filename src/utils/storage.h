@@ -1,41 +1,66 @@
 ﻿#pragma once
+#include <tracy/Tracy.hpp>
+
 #include "common/const.h"
 #include "common/utils.h"
+#include "utils/offset_allocator.h"
 
 namespace dt
 {
+    // 在Backend提供的线性内存上分配块，块可以释放，释放的空间和相邻空闲空间合并后重新分配
+    // key由块下标和代数组成，释放后旧的key失效
     template <typename Backend>
     class Storage
     {
     public:
-        size_t GetSizeB() const { return m_sizeB; }
+        size_t GetSizeB() const { return m_allocator.GetUsedSizeB(); }
+        size_t GetFragmentedSizeB() const { return m_allocator.GetFragmentedSizeB(); }
 
         size_t Alloc(size_t sizeB);
+        void Free(size_t key);
+        bool IsValid(size_t key) const;
         void GetBlock(size_t key, size_t& offsetB, size_t& sizeB);
         
         void Write(size_t key, const void* data);
         void Read(size_t key, void* data);
         void Reserve(size_t capacityB);
 
+        // 从后往前把块搬到它前面的空洞里，每次最多搬maxMoveB字节、尝试DEFRAG_MAX_TRY_COUNT个块，下次调用从停下的位置继续
+        // 返回是否移动了块，移动后之前通过GetBlock拿到的偏移失效
+        bool Defragment(size_t maxMoveB);
+
     private:
+        static constexpr uint32_t DEFRAG_MAX_TRY_COUNT = 64;
+
         Storage() = default;
         
         size_t DerivedGetCapacity() { return static_cast<Backend*>(this)->GetCapacity(); }
         void DerivedSetCapacity(size_t capacityB) { return static_cast<Backend*>(this)->SetCapacity(capacityB); }
         void DerivedWrite(size_t offsetB, size_t sizeB, const void* data) { static_cast<Backend*>(this)->Write(offsetB, sizeB, data); }
         void DerivedRead(size_t offsetB, size_t sizeB, void* data) { static_cast<Backend*>(this)->Read(offsetB, sizeB, data); }
+        void DerivedMove(size_t srcOffsetB, size_t dstOffsetB, size_t sizeB) { static_cast<Backend*>(this)->Move(srcOffsetB, dstOffsetB, sizeB); }
         
         struct Block
         {
-            size_t key;
             size_t offsetB;
             size_t sizeB;
+            uint32_t node;
+            uint32_t generation;
+            bool used;
         };
-        
-        uint32_t m_sizeB = 0;
 
-        umap<size_t, uint32_t> m_keyMapper;
-        vec<Block> m_elements;
+        // 分配的大小向上取整到这个值，保证偏移是它的整数倍
+        size_t m_alignmentB = 1;
+
+        OffsetAllocator m_allocator;
+        vec<Block> m_blocks;
+        vec<uint32_t> m_freeBlocks;
+        // 整理碎片时只处理偏移小于它的块
+        size_t m_defragCursorB = SIZE_MAX;
+
+        uint32_t GetBlockIndex(size_t key) const;
+        size_t GetAllocSizeB(size_t sizeB) const;
+        void SyncCapacity();
         
         friend Backend;
     };
@@ -45,47 +70,73 @@ namespace dt
     {
         assert(DerivedGetCapacity() > 0);
         
-        auto newSize = m_sizeB + sizeB;
-        Reserve(newSize);
+        SyncCapacity();
+
+        uint32_t index;
+        if (!m_freeBlocks.empty())
+        {
+            index = m_freeBlocks.back();
+            m_freeBlocks.pop_back();
+        }
+        else
+        {
+            index = static_cast<uint32_t>(m_blocks.size());
+            m_blocks.push_back({ 0, 0, OffsetAllocator::INVALID_NODE, 0, false });
+        }
+
+        auto allocSizeB = GetAllocSizeB(sizeB);
+        auto node = m_allocator.Alloc(allocSizeB, index);
+        if (node == OffsetAllocator::INVALID_NODE)
+        {
+            // 末尾的空闲空间加上扩容的部分一定放得下
+            Reserve(m_allocator.GetCapacity() + allocSizeB);
+            node = m_allocator.Alloc(allocSizeB, index);
+            assert(node != OffsetAllocator::INVALID_NODE);
+        }
 
-        Block obj;
-        obj.key = Utils::GetRandomSizeT();
-        obj.offsetB = m_sizeB;
-        obj.sizeB = sizeB;
+        auto& block = m_blocks[index];
+        block.offsetB = m_allocator.GetOffset(node);
+        block.sizeB = sizeB;
+        block.node = node;
+        block.used = true;
+
+        return static_cast<size_t>(block.generation) << 32 | index;
+    }
+
+    template <typename T>
+    void Storage<T>::Free(const size_t key)
+    {
+        auto index = GetBlockIndex(key);
+        auto& block = m_blocks[index];
 
-        assert(m_keyMapper.find(obj.key) == m_keyMapper.end());
+        m_allocator.Free(block.node);
 
-        m_keyMapper[obj.key] = static_cast<uint32_t>(m_elements.size());
-        m_elements.push_back(obj);
+        block.node = OffsetAllocator::INVALID_NODE;
+        block.used = false;
+        ++block.generation;
+        m_freeBlocks.push_back(index);
+    }
 
-        m_sizeB = newSize;
+    template <typename T>
+    bool Storage<T>::IsValid(const size_t key) const
+    {
+        auto index = static_cast<uint32_t>(key);
+        auto generation = static_cast<uint32_t>(key >> 32);
 
-        return obj.key;
+        return index < m_blocks.size() && m_blocks[index].used && m_blocks[index].generation == generation;
     }
 
     template <typename T>
     void Storage<T>::Write(const size_t key, const void* data)
     {
-        auto it = m_keyMapper.find(key);
-        if (it == m_keyMapper.end())
-        {
-            THROW_ERRORF("Can't find element with index %d", key)
-        }
-        
-        auto& element = m_elements[it->second];
+        auto& element = m_blocks[GetBlockIndex(key)];
         DerivedWrite(element.offsetB, element.sizeB, data);
     }
 
     template <typename T>
     void Storage<T>::Read(const size_t key, void* data)
     {
-        auto it = m_keyMapper.find(key);
-        if (it == m_keyMapper.end())
-        {
-            THROW_ERRORF("Can't find element with index %d", key)
-        }
-
-        auto& element = m_elements[it->second];
+        auto& element = m_blocks[GetBlockIndex(key)];
         DerivedRead(element.offsetB, element.sizeB, data);
     }
 
@@ -102,19 +153,106 @@ namespace dt
 
             DerivedSetCapacity(newCapacityB);
         }
+
+        SyncCapacity();
     }
 
     template <typename T>
-    void Storage<T>::GetBlock(const size_t key, size_t& offsetB, size_t& sizeB)
+    bool Storage<T>::Defragment(const size_t maxMoveB)
     {
-        auto it = m_keyMapper.find(key);
-        if (it == m_keyMapper.end())
+        ZoneScoped;
+
+        SyncCapacity();
+
+        if (m_allocator.IsCompact())
+        {
+            m_defragCursorB = SIZE_MAX;
+            return false;
+        }
+
+        // 已使用的块在分配器里的节点不会因为其他块的分配和释放而改变，可以一直沿着它往前找
+        auto getPrevUsedNode = [this](uint32_t node)
+        {
+            while (node != OffsetAllocator::INVALID_NODE && !m_allocator.IsUsed(node))
+            {
+                node = m_allocator.GetPrevNode(node);
+            }
+            return node;
+        };
+
+        auto node = getPrevUsedNode(m_allocator.GetLastNode());
+        while (node != OffsetAllocator::INVALID_NODE && m_allocator.GetOffset(node) >= m_defragCursorB)
         {
-            THROW_ERRORF("Can't find element with index %d", key)
+            node = getPrevUsedNode(m_allocator.GetPrevNode(node));
+        }
+
+        auto moved = false;
+        size_t movedSizeB = 0;
+        uint32_t tryCount = 0;
+        while (node != OffsetAllocator::INVALID_NODE && movedSizeB < maxMoveB && tryCount < DEFRAG_MAX_TRY_COUNT)
+        {
+            auto prevNode = getPrevUsedNode(m_allocator.GetPrevNode(node));
+            auto index = m_allocator.GetUserData(node);
+            auto& block = m_blocks[index];
+            auto allocSizeB = m_allocator.GetSize(node);
+
+            auto newNode = m_allocator.AllocBefore(allocSizeB, block.offsetB, index);
+            if (newNode != OffsetAllocator::INVALID_NODE)
+            {
+                auto newOffsetB = m_allocator.GetOffset(newNode);
+                DerivedMove(block.offsetB, newOffsetB, block.sizeB);
+                m_allocator.Free(node);
+
+                block.offsetB = newOffsetB;
+                block.node = newNode;
+
+                movedSizeB += allocSizeB;
+                moved = true;
+            }
+
+            node = prevNode;
+            ++tryCount;
         }
 
-        auto& element = m_elements[it->second];
+        m_defragCursorB = node != OffsetAllocator::INVALID_NODE ? m_allocator.GetOffset(node) + 1 : SIZE_MAX;
+
+        return moved;
+    }
+
+    template <typename T>
+    void Storage<T>::GetBlock(const size_t key, size_t& offsetB, size_t& sizeB)
+    {
+        auto& element = m_blocks[GetBlockIndex(key)];
         offsetB = element.offsetB;
         sizeB = element.sizeB;
     }
+
+    template <typename T>
+    uint32_t Storage<T>::GetBlockIndex(const size_t key) const
+    {
+        if (!IsValid(key))
+        {
+            THROW_ERRORF("Can't find element with index %zu", key)
+        }
+
+        return static_cast<uint32_t>(key);
+    }
+
+    template <typename T>
+    size_t Storage<T>::GetAllocSizeB(const size_t sizeB) const
+    {
+        auto allocSizeB = (sizeB + m_alignmentB - 1) / m_alignmentB * m_alignmentB;
+        return (std::max)(allocSizeB, m_alignmentB);
+    }
+
+    template <typename T>
+    void Storage<T>::SyncCapacity()
+    {
+        // Backend可能直接修改容量，分配前把多出的部分交给分配器
+        auto capacityB = DerivedGetCapacity();
+        if (capacityB > m_allocator.GetCapacity())
+        {
+            m_allocator.Grow(capacityB);
+        }
+    }
 }
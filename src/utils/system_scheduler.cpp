@@ -0,0 +1,141 @@
+#include "system_scheduler.h"
+
+#include <cstring>
+#include <tracy/Tracy.hpp>
+
+#include "common/utils.h"
+
+namespace dt
+{
+    void SystemScheduler::Execute(JobScheduler* scheduler)
+    {
+        ZoneScoped;
+
+        assert(scheduler);
+
+        m_frameStartTime = std::chrono::steady_clock::now();
+
+        // 主线程系统的job也是根，依赖多个根的job只在这里装填一次计数，之后提交时不再重置
+        for (auto& system : m_systems)
+        {
+            if (system->job->IsRoot())
+            {
+                system->job->Reset();
+            }
+        }
+
+        for (auto& system : m_systems)
+        {
+            if (!system->mainThread && system->job->IsRoot())
+            {
+                scheduler->Schedule(system->job, false);
+            }
+        }
+
+        // 主线程系统按注册顺序执行，之前的主线程系统已经执行完，只需等待依赖的job
+        for (uint32_t i = 0; i < m_systems.size(); ++i)
+        {
+            auto& system = m_systems[i];
+            if (!system->mainThread)
+            {
+                continue;
+            }
+
+            for (auto dependency : system->dependencies)
+            {
+                if (!m_systems[dependency]->mainThread)
+                {
+                    m_systems[dependency]->job->WaitForStop(true);
+                }
+            }
+
+            Run(i);
+            scheduler->Schedule(system->job, false);
+        }
+
+        for (auto& system : m_systems)
+        {
+            system->job->WaitForStop(true);
+        }
+
+        for (auto& timing : m_timeline)
+        {
+            TracyPlot(timing.name, static_cast<double>(timing.endMs - timing.startMs));
+        }
+    }
+
+    void SystemScheduler::AddSystem(up<System>&& system)
+    {
+        assert(m_systems.size() < MAX_SYSTEM_COUNT);
+
+        auto index = static_cast<uint32_t>(m_systems.size());
+
+        // 从后往前找有读写冲突的系统，已经被间接依赖的系统不再重复添加
+        for (auto i = static_cast<int32_t>(index) - 1; i >= 0; --i)
+        {
+            auto& other = m_systems[i];
+            auto conflict = (other->writeMask & (system->readMask | system->writeMask)) != 0 ||
+                (other->readMask & system->writeMask) != 0;
+            if (!conflict || (system->ancestorMask & 1ull << i) != 0)
+            {
+                continue;
+            }
+
+            system->dependencies.push_back(i);
+            system->ancestorMask |= other->ancestorMask | 1ull << i;
+        }
+
+        if (system->mainThread)
+        {
+            system->job = Job::CreateCommon([] {});
+        }
+        else
+        {
+            system->job = Job::CreateCommon([this, index]
+            {
+                Run(index);
+            });
+
+            // 主线程系统没有真正在job上执行，依赖的是它执行完后才提交的job
+            for (auto dependency : system->dependencies)
+            {
+                system->job->DependsOn(m_systems[dependency]->job);
+            }
+        }
+
+        m_systems.push_back(std::move(system));
+        m_timeline.push_back({ m_systems.back()->name, {}, 0.0f, 0.0f });
+    }
+
+    void SystemScheduler::Run(const uint32_t index)
+    {
+        ZoneScopedN("System");
+
+        auto& system = m_systems[index];
+        ZoneText(system->name, strlen(system->name));
+
+        auto& timing = m_timeline[index];
+        timing.thread = std::this_thread::get_id();
+        timing.startMs = GetFrameTimeMs();
+
+        system->update();
+
+        timing.endMs = GetFrameTimeMs();
+    }
+
+    float SystemScheduler::GetFrameTimeMs() const
+    {
+        return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - m_frameStartTime).count();
+    }
+
+    uint64_t SystemScheduler::ToMask(const std::initializer_list<SystemData> data)
+    {
+        uint64_t mask = 0;
+        for (auto d : data)
+        {
+            mask |= 1ull << static_cast<uint8_t>(d);
+        }
+
+        return mask;
+    }
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <chrono>
+#include <functional>
+#include <initializer_list>
+#include <thread>
+
+#include "common/const.h"
+#include "utils/job_scheduler.h"
+
+namespace dt
+{
+    // 每帧系统读写的数据，用于推导系统之间的依赖
+    enum class SystemData : uint8_t
+    {
+        TRANSFORM,
+        RENDER_OBJECT,
+        BATCH,
+        CBUFFER,
+        GUI,
+        RESOURCE,
+        RECYCLE_BIN,
+        FRAME_INFO, // GameResource里的帧号和时间，只在系统执行前由Game更新
+        BACKGROUND_TASK, // JobScheduler的后台任务队列
+        BATCH_QUEUE, // BatchRenderer待注册、待注销和矩阵变化的队列
+        BATCH_MATRIX, // BatchRenderer的矩阵CPU数据和上一次取出的脏矩阵
+        COUNT
+    };
+
+    // 每帧执行的一组系统，按注册顺序和声明的读写数据推导依赖，读写不冲突的系统并行执行
+    // 只能在主线程执行的系统由调用Execute的线程按顺序执行，其他系统作为job提交到JobScheduler
+    class SystemScheduler
+    {
+    public:
+        static constexpr uint32_t MAX_SYSTEM_COUNT = 64;
+
+        struct SystemTiming
+        {
+            const char* name;
+            std::thread::id thread;
+            float startMs;
+            float endMs;
+        };
+
+        SystemScheduler() = default;
+        SystemScheduler(const SystemScheduler& other) = delete;
+        SystemScheduler(SystemScheduler&& other) noexcept = delete;
+        SystemScheduler& operator=(const SystemScheduler& other) = delete;
+        SystemScheduler& operator=(SystemScheduler&& other) noexcept = delete;
+
+        // 上一次Execute中每个系统相对于帧开始的执行时间段，Execute结束时每个系统的耗时也会输出到Tracy的同名图表
+        crvec<SystemTiming> GetTimeline() const { return m_timeline; }
+
+        // name需要在整个程序运行期间有效，Tracy只记录指针
+        template <typename F>
+        void AddSystem(const char* name, std::initializer_list<SystemData> reads, std::initializer_list<SystemData> writes, F&& f, bool mainThread = false);
+        void Execute(JobScheduler* scheduler);
+
+    private:
+        struct System
+        {
+            const char* name;
+            uint64_t readMask;
+            uint64_t writeMask;
+            bool mainThread;
+            func<void()> update;
+
+            // 直接依赖的系统，以及所有直接和间接依赖的系统
+            vec<uint32_t> dependencies;
+            uint64_t ancestorMask;
+
+            // 主线程系统的job只用于在执行完后放行依赖它的job
+            sp<Job> job;
+        };
+
+        vecup<System> m_systems;
+        vec<SystemTiming> m_timeline;
+        std::chrono::steady_clock::time_point m_frameStartTime;
+
+        void AddSystem(up<System>&& system);
+        void Run(uint32_t index);
+        float GetFrameTimeMs() const;
+
+        static uint64_t ToMask(std::initializer_list<SystemData> data);
+    };
+
+    template <typename F>
+    void SystemScheduler::AddSystem(
+        const char* name, const std::initializer_list<SystemData> reads, const std::initializer_list<SystemData> writes, F&& f, const bool mainThread)
+    {
+        auto system = mup<System>();
+        system->name = name;
+        system->readMask = ToMask(reads);
+        system->writeMask = ToMask(writes);
+        system->mainThread = mainThread;
+        system->update = std::forward<F>(f);
+        system->ancestorMask = 0;
+
+        AddSystem(std::move(system));
+    }
+}
@@ -1,56 +1,546 @@
 #include "thread_pool.h"
 
+#include <chrono>
+
 #include "consumer_thread.h"
 
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 namespace dt
 {
-    ThreadPool::ThreadPool(const uint32_t numThreads)
+    bool ThreadPool::WorkDeque::Push(Task& task)
+    {
+        auto b = bottom.load(std::memory_order_relaxed);
+        auto t = top.load(std::memory_order_acquire);
+        if (b - t >= CAPACITY)
+        {
+            return false;
+        }
+
+        // 槽位上一次的task已经被取走，只可能还有偷取的线程在移出
+        auto& cell = cells[b % CAPACITY];
+        while (cell.full.load(std::memory_order_acquire))
+        {
+            std::this_thread::yield();
+        }
+
+        cell.task = std::move(task);
+        cell.full.store(true, std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool ThreadPool::WorkDeque::Pop(Task& task)
+    {
+        auto b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto t = top.load(std::memory_order_relaxed);
+
+        if (t > b)
+        {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        if (t == b)
+        {
+            // 只剩最后一个，和偷取的线程竞争
+            auto won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom.store(b + 1, std::memory_order_relaxed);
+            if (!won)
+            {
+                return false;
+            }
+        }
+
+        Take(cells[b % CAPACITY], task);
+        return true;
+    }
+
+    bool ThreadPool::WorkDeque::Steal(Task& task)
     {
+        auto t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto b = bottom.load(std::memory_order_acquire);
+        if (t >= b)
+        {
+            return false;
+        }
+
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            return false;
+        }
+
+        Take(cells[t % CAPACITY], task);
+        return true;
+    }
+
+    void ThreadPool::WorkDeque::Take(Cell& cell, Task& task)
+    {
+        // 赢得这个位置时task一定已经写入，等待full只是为了和写入方同步
+        while (!cell.full.load(std::memory_order_acquire))
+        {
+            std::this_thread::yield();
+        }
+
+        task = std::move(cell.task);
+        cell.full.store(false, std::memory_order_release);
+    }
+
+    ThreadPool::ThreadPool(const uint32_t numThreads, const bool pinThreads, const bool useFibers)
+    {
+        assert(numThreads > 0);
+
+        m_pinThreads = pinThreads;
+        m_useFibers = useFibers;
+
         for (uint32_t i = 0; i < numThreads; ++i)
         {
-            m_threads.emplace_back(&ThreadPool::Worker, this);
+            m_workers.push_back(mup<WorkerContext>());
+        }
+
+        for (uint32_t i = 0; i < numThreads; ++i)
+        {
+            m_threads.emplace_back(&ThreadPool::Worker, this, i);
         }
     }
 
     ThreadPool::~ThreadPool()
     {
         {
-            std::lock_guard lock(m_taskMutex);
+            std::lock_guard lock(m_sleepMutex);
             m_shutdown = true;
-            m_taskCond.notify_all();
+            m_sleepCond.notify_all();
         }
 
         for (auto& thread : m_threads)
         {
             thread.join();
         }
+
+        assert(m_freeFibers.size() == m_fibers.size() && "Fibers are still suspended");
     }
 
-    void ThreadPool::Worker()
+    void ThreadPool::Push(Task&& task, const int32_t priority)
+    {
+        // 先增加计数再发布，取走task后的递减不会让计数回绕
+        m_pendingCount.fetch_add(1);
+
+        // worker里提交的任务进自己的队列，外部线程提交的或自己的队列满了进注入队列
+        auto level = GetPriorityLevel(priority);
+        if (GetCurPool() != this || !m_workers[GetCurWorkerIndex()]->deques[level].Push(task))
+        {
+            std::lock_guard lock(m_injectQueue.mutex);
+            m_injectQueue.count.fetch_add(1);
+            m_injectQueue.tasks[level].PushBack(std::move(task));
+        }
+
+        Wake(1);
+    }
+
+    void ThreadPool::Wake(const uint32_t count)
+    {
+        // 这里先增加任务计数再读m_sleepingCount，Worker先增加m_sleepingCount再读任务计数，都是seq_cst，不会两边都没看到
+        // 没有worker在睡眠时不需要加锁通知
+        auto sleepingCount = m_sleepingCount.load();
+        if (sleepingCount == 0)
+        {
+            return;
+        }
+
+        {
+            std::lock_guard lock(m_sleepMutex);
+        }
+
+        if (count >= sleepingCount)
+        {
+            m_sleepCond.notify_all();
+            return;
+        }
+
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            m_sleepCond.notify_one();
+        }
+    }
+
+    void ThreadPool::BeginFrame(const float backgroundBudgetMs)
+    {
+        auto budgetNs = backgroundBudgetMs > 0 ? static_cast<int64_t>(backgroundBudgetMs * 1000000.0) : INT64_MAX;
+        m_backgroundBudgetNs.store(budgetNs, std::memory_order_relaxed);
+
+        if (m_backgroundCount.load(std::memory_order_acquire) > 0)
+        {
+            {
+                std::lock_guard lock(m_sleepMutex);
+            }
+            m_sleepCond.notify_all();
+        }
+    }
+
+    bool ThreadPool::ShouldYieldBackground() const
+    {
+        return m_pendingCount.load(std::memory_order_relaxed) > 0 || m_backgroundBudgetNs.load(std::memory_order_relaxed) <= 0;
+    }
+
+    void ThreadPool::PushBackground(BackgroundTask&& task)
+    {
+        {
+            std::lock_guard lock(m_backgroundMutex);
+            m_backgroundTasks.PushBack(std::move(task));
+        }
+        m_backgroundCount.fetch_add(1);
+        Wake(1);
+    }
+
+    bool ThreadPool::CanRunBackground() const
+    {
+        return m_backgroundCount.load() > 0 && m_backgroundBudgetNs.load(std::memory_order_relaxed) > 0;
+    }
+
+    bool ThreadPool::TryRunBackground()
+    {
+        if (!CanRunBackground())
+        {
+            return false;
+        }
+
+        BackgroundTask task;
+
+        {
+            std::lock_guard lock(m_backgroundMutex);
+            if (m_backgroundTasks.Empty())
+            {
+                return false;
+            }
+
+            task = m_backgroundTasks.PopFront();
+        }
+        m_backgroundCount.fetch_sub(1, std::memory_order_relaxed);
+
+        auto startTime = std::chrono::steady_clock::now();
+        auto unfinished = task();
+        auto timeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count();
+        m_backgroundBudgetNs.fetch_sub(timeNs, std::memory_order_relaxed);
+
+        if (unfinished)
+        {
+            PushBackground(std::move(task));
+        }
+
+        return true;
+    }
+
+    bool ThreadPool::Suspend(const ParkFunc& park)
+    {
+        // 不在fiber中时返回false，由调用者自己阻塞等待
+        auto fiber = GetCurFiber();
+        if (!fiber)
+        {
+            return false;
+        }
+
+        // 恢复后可能在其他worker上，之后不能再使用挂起前读取的线程局部变量
+        auto& worker = *fiber->pool->m_workers[fiber->workerIndex];
+        worker.park = &park;
+        Fiber::Switch(*fiber->fiber, *worker.threadFiber);
+
+        return true;
+    }
+
+    void ThreadPool::Resume(TaskFiber* fiber)
+    {
+        auto pool = fiber->pool;
+
+        pool->m_pendingCount.fetch_add(1);
+        {
+            std::lock_guard lock(pool->m_fiberMutex);
+            pool->m_readyFibers.push_back(fiber);
+        }
+        pool->Wake(1);
+    }
+
+    bool ThreadPool::TryAcquire(const uint32_t workerIndex, Task& task)
+    {
+        if (m_pendingCount.load(std::memory_order_acquire) == 0)
+        {
+            return false;
+        }
+
+        // 高优先级的task不论在哪个队列都先执行，同一档里依次是自己的队列、注入队列和其他worker的队列
+        auto workerCount = static_cast<uint32_t>(m_workers.size());
+        auto isWorker = workerIndex != EXTERNAL_WORKER_INDEX;
+        for (uint32_t level = 0; level < PRIORITY_LEVEL_COUNT; ++level)
+        {
+            auto acquired = isWorker && m_workers[workerIndex]->deques[level].Pop(task);
+            acquired = acquired || PopInjected(level, workerIndex, task);
+
+            auto start = isWorker ? workerIndex + 1 : 0;
+            for (uint32_t i = 0; !acquired && i < workerCount; ++i)
+            {
+                auto victim = (start + i) % workerCount;
+                acquired = victim != workerIndex && m_workers[victim]->deques[level].Steal(task);
+            }
+
+            if (acquired)
+            {
+                m_pendingCount.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool ThreadPool::PopInjected(const uint32_t level, const uint32_t workerIndex, Task& task)
+    {
+        if (m_injectQueue.count.load(std::memory_order_acquire) == 0)
+        {
+            return false;
+        }
+
+        std::lock_guard lock(m_injectQueue.mutex);
+        auto& ring = m_injectQueue.tasks[level];
+        if (ring.Empty())
+        {
+            return false;
+        }
+
+        task = ring.PopFront();
+        uint32_t takenCount = 1;
+
+        // 一次多搬几个到自己的队列，减少争抢注入队列的锁，搬过去的task仍可以被其他worker偷走
+        if (workerIndex != EXTERNAL_WORKER_INDEX)
+        {
+            auto& deque = m_workers[workerIndex]->deques[level];
+            auto grabCount = (std::min)(ring.count / static_cast<uint32_t>(m_workers.size()), INJECT_GRAB_COUNT);
+            for (uint32_t i = 0; i < grabCount; ++i)
+            {
+                // Push失败时不会移动task，成功后再出队
+                if (!deque.Push(ring.tasks[ring.head]))
+                {
+                    break;
+                }
+
+                ring.PopFront();
+                ++takenCount;
+            }
+        }
+
+        m_injectQueue.count.fetch_sub(takenCount, std::memory_order_relaxed);
+        return true;
+    }
+
+    void ThreadPool::PinCurrentThread(const uint32_t workerIndex) const
+    {
+        // 前几个核心留给主线程和渲染线程
+        auto coreCount = (std::max)(std::thread::hardware_concurrency(), 1u);
+        auto core = (workerIndex + JOB_RESERVED_THREAD_COUNT) % coreCount;
+
+#ifdef _WIN32
+        // 超过64个逻辑处理器时分为多个处理器组，亲和性掩码只能表示组内的处理器，需要先找到core所在的组
+        auto groupCount = GetActiveProcessorGroupCount();
+        for (WORD group = 0; group < groupCount; ++group)
+        {
+            auto groupSize = GetActiveProcessorCount(group);
+            if (core < groupSize)
+            {
+                GROUP_AFFINITY affinity = {};
+                affinity.Group = group;
+                affinity.Mask = static_cast<KAFFINITY>(1) << core;
+                SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr);
+                return;
+            }
+
+            core -= groupSize;
+        }
+#elif defined(__linux__)
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        CPU_SET(core, &cpuSet);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuSet);
+#endif
+    }
+
+    bool ThreadPool::TryRunOne()
+    {
+        Task task;
+        if (!TryAcquire(GetCurPool() == this ? GetCurWorkerIndex() : EXTERNAL_WORKER_INDEX, task))
+        {
+            return false;
+        }
+
+        task();
+        return true;
+    }
+
+    ThreadPool* ThreadPool::GetCurPool()
+    {
+        return s_curPool;
+    }
+
+    uint32_t ThreadPool::GetCurWorkerIndex()
+    {
+        return s_curWorkerIndex;
+    }
+
+    ThreadPool::TaskFiber* ThreadPool::GetCurFiber()
+    {
+        return s_curFiber;
+    }
+
+    void ThreadPool::Worker(const uint32_t workerIndex)
     {
         tracy::SetThreadName("ThreadPool Worker");
-        
+
+        s_curPool = this;
+        s_curWorkerIndex = workerIndex;
+
+        if (m_pinThreads)
+        {
+            PinCurrentThread(workerIndex);
+        }
+
+        if (m_useFibers)
+        {
+            m_workers[workerIndex]->threadFiber = mup<Fiber>();
+        }
+
         while (true)
         {
             Task task;
-            
+            TaskFiber* fiber = nullptr;
+
+            // 优先恢复被唤醒的fiber
+            if (m_useFibers && PopReadyFiber(fiber))
             {
-                std::unique_lock lock(m_taskMutex);
-                m_taskCond.wait(lock, [this]
+                RunFiber(workerIndex, fiber);
+                continue;
+            }
+
+            if (!TryAcquire(workerIndex, task))
+            {
+                // 帧任务都执行完了才执行后台任务
+                if (TryRunBackground())
+                {
+                    continue;
+                }
+
+                std::unique_lock lock(m_sleepMutex);
+                m_sleepingCount.fetch_add(1);
+                m_sleepCond.wait(lock, [this]
                 {
-                    return m_shutdown || !m_tasks.empty();
+                    return m_shutdown || m_pendingCount.load() > 0 || CanRunBackground();
                 });
-                
+                m_sleepingCount.fetch_sub(1);
+
                 if (m_shutdown)
                 {
-                    return;
+                    break;
                 }
-                
-                task = m_tasks.top().second;
-                m_tasks.pop();
+
+                continue;
+            }
+
+            if (m_useFibers)
+            {
+                RunFiber(workerIndex, AcquireFiber(std::move(task)));
+            }
+            else
+            {
+                task();
+            }
+        }
+
+        m_workers[workerIndex]->threadFiber.reset();
+    }
+
+    ThreadPool::TaskFiber* ThreadPool::AcquireFiber(Task&& task)
+    {
+        TaskFiber* fiber = nullptr;
+
+        {
+            std::lock_guard lock(m_fiberMutex);
+            if (!m_freeFibers.empty())
+            {
+                fiber = m_freeFibers.back();
+                m_freeFibers.pop_back();
+            }
+            else
+            {
+                auto newFiber = mup<TaskFiber>();
+                newFiber->pool = this;
+                newFiber->fiber = mup<Fiber>(&ThreadPool::FiberMain, newFiber.get(), JOB_FIBER_STACK_SIZE);
+                fiber = newFiber.get();
+                m_fibers.push_back(std::move(newFiber));
             }
+        }
+
+        fiber->task = std::move(task);
+        return fiber;
+    }
+
+    bool ThreadPool::PopReadyFiber(TaskFiber*& fiber)
+    {
+        std::lock_guard lock(m_fiberMutex);
+        if (m_readyFibers.empty())
+        {
+            return false;
+        }
+
+        fiber = m_readyFibers.back();
+        m_readyFibers.pop_back();
+        m_pendingCount.fetch_sub(1, std::memory_order_relaxed);
+
+        return true;
+    }
+
+    void ThreadPool::RunFiber(const uint32_t workerIndex, TaskFiber* fiber)
+    {
+        auto& worker = *m_workers[workerIndex];
+
+        while (true)
+        {
+            fiber->workerIndex = workerIndex;
+            s_curFiber = fiber;
+            Fiber::Switch(*worker.threadFiber, *fiber->fiber);
+            s_curFiber = nullptr;
+
+            // 没有park说明task已经执行完，fiber可以复用
+            auto park = std::exchange(worker.park, nullptr);
+            if (!park)
+            {
+                std::lock_guard lock(m_fiberMutex);
+                m_freeFibers.push_back(fiber);
+                return;
+            }
+
+            if ((*park)(fiber))
+            {
+                return;
+            }
+        }
+    }
+
+    void ThreadPool::FiberMain(void* arg)
+    {
+        auto fiber = static_cast<TaskFiber*>(arg);
+
+        while (true)
+        {
+            fiber->task();
+            fiber->task.Reset();
 
-            task();
+            // task执行期间可能挂起过，要切回当前所在的worker
+            auto& worker = *fiber->pool->m_workers[fiber->workerIndex];
+            Fiber::Switch(*fiber->fiber, *worker.threadFiber);
         }
     }
 }
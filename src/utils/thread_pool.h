@@ -1,51 +1,274 @@
 #pragma once
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstdint>
 #include <functional>
 #include <mutex>
-#include <queue>
 #include <thread>
 
 #include "common/const.h"
+#include "utils/fiber.h"
+#include "utils/inline_func.h"
 
 namespace dt
 {
     class ThreadPool
     {
-        using Task = std::function<void()>;
+        using Task = InlineFunc<void()>;
+        using BackgroundTask = InlineFunc<bool()>;
 
-        struct CompareByPriority
+        // 优先级只区分正数、0和负数三档，每档一组队列
+        static constexpr uint32_t PRIORITY_LEVEL_COUNT = 3;
+
+        // 环形缓冲，只在容量不足时扩容，出队不会释放内存
+        template <typename T>
+        struct TaskRing
+        {
+            vec<T> tasks;
+            uint32_t head = 0;
+            uint32_t count = 0;
+
+            bool Empty() const { return count == 0; }
+            void PushBack(T&& task);
+            T PopBack();
+            T PopFront();
+        };
+
+        // Chase-Lev队列，只有所属worker从底部Push和Pop（LIFO），其他线程从顶部偷（FIFO），都不加锁
+        // 槽位的full标记在task被取走后才清除，偷取的线程移出task期间所属worker不会覆盖这个槽位
+        struct WorkDeque
         {
-            bool operator()(const std::pair<int32_t, Task>& a, const std::pair<int32_t, Task>& b) const
+            static constexpr int64_t CAPACITY = 256;
+
+            struct Cell
             {
-                return a.first < b.first;
-            }
+                std::atomic<bool> full = false;
+                Task task;
+            };
+
+            alignas(64) std::atomic<int64_t> top = 0;
+            alignas(64) std::atomic<int64_t> bottom = 0;
+            vec<Cell> cells = vec<Cell>(CAPACITY);
+
+            // 队列满时返回false，task不会被移动
+            bool Push(Task& task);
+            bool Pop(Task& task);
+            bool Steal(Task& task);
+
+            static void Take(Cell& cell, Task& task);
         };
-        
+
+        // 非worker线程提交的task进入共用的注入队列，worker从中取task时顺便搬一部分到自己的队列
+        struct InjectQueue
+        {
+            std::mutex mutex;
+            std::array<TaskRing<Task>, PRIORITY_LEVEL_COUNT> tasks;
+            std::atomic<uint32_t> count = 0;
+        };
+
     public:
-        explicit ThreadPool(uint32_t numThreads);
+        // 执行task的fiber，task中等待时挂起整个fiber，worker转而执行其他task
+        struct TaskFiber
+        {
+            up<Fiber> fiber;
+            ThreadPool* pool = nullptr;
+            uint32_t workerIndex = 0;
+            Task task;
+        };
+
+        // 在worker切回后调用，返回false表示不需要挂起，fiber立即继续执行
+        using ParkFunc = InlineFunc<bool(TaskFiber*)>;
+
+        explicit ThreadPool(uint32_t numThreads, bool pinThreads = false, bool useFibers = false);
         ~ThreadPool();
         ThreadPool(const ThreadPool& other) = delete;
         ThreadPool(ThreadPool&& other) noexcept = delete;
         ThreadPool& operator=(const ThreadPool& other) = delete;
         ThreadPool& operator=(ThreadPool&& other) noexcept = delete;
 
+        uint32_t GetThreadCount() const { return static_cast<uint32_t>(m_threads.size()); }
+        bool IsFiberMode() const { return m_useFibers; }
+
         template <typename F>
         void Run(F&& task, int32_t priority = 0);
+        // 提交count个相同的task，只发布一次、唤醒一次
+        template <typename F>
+        void RunMany(const F& task, uint32_t count, int32_t priority = 0);
+        bool TryRunOne();
+
+        // 后台任务只在没有帧任务时执行，每次调用只做一小段工作，返回true表示还有剩余工作，重新排到队尾
+        // 后台任务直接在worker线程上执行，不会挂起fiber
+        template <typename F>
+        void RunBackground(F&& task);
+        // 每帧开始时重置后台任务可用的CPU时间，budgetMs为0时不限制
+        void BeginFrame(float backgroundBudgetMs);
+        // 有帧任务在等待或预算已用完时返回true，耗时的后台任务应轮询并尽快返回
+        bool ShouldYieldBackground() const;
+
+        static bool IsInFiber() { return GetCurFiber() != nullptr; }
+        static bool Suspend(const ParkFunc& park);
+        static void Resume(TaskFiber* fiber);
 
     private:
+        static constexpr uint32_t EXTERNAL_WORKER_INDEX = UINT32_MAX;
+        // worker从注入队列取task时最多顺便搬到自己队列的数量
+        static constexpr uint32_t INJECT_GRAB_COUNT = 8;
+
+        // fiber模式下worker的状态，挂起时由worker在切回自身后执行park，避免fiber还没切走就被其他线程恢复
+        struct WorkerContext
+        {
+            std::array<WorkDeque, PRIORITY_LEVEL_COUNT> deques;
+            up<Fiber> threadFiber;
+            const ParkFunc* park = nullptr;
+        };
+
         vec<std::thread> m_threads;
-        std::priority_queue<std::pair<int32_t, Task>, std::vector<std::pair<int32_t, Task>>, CompareByPriority> m_tasks;
-        std::mutex m_taskMutex;
-        std::condition_variable m_taskCond;
+        InjectQueue m_injectQueue;
+        // 已提交还没被取走的task和待恢复的fiber数量，总是在发布之前增加，不会小于队列里实际的数量
+        std::atomic<uint32_t> m_pendingCount = 0;
+
+        std::mutex m_sleepMutex;
+        std::condition_variable m_sleepCond;
+        std::atomic<uint32_t> m_sleepingCount = 0;
         bool m_shutdown = false;
+        bool m_pinThreads = false;
 
-        void Worker();
+        bool m_useFibers = false;
+        vecup<WorkerContext> m_workers;
+        vecup<TaskFiber> m_fibers;
+        vec<TaskFiber*> m_freeFibers;
+        vec<TaskFiber*> m_readyFibers;
+        std::mutex m_fiberMutex;
+
+        std::mutex m_backgroundMutex;
+        TaskRing<BackgroundTask> m_backgroundTasks;
+        std::atomic<uint32_t> m_backgroundCount = 0;
+        std::atomic<int64_t> m_backgroundBudgetNs = INT64_MAX;
+
+        inline static thread_local ThreadPool* s_curPool = nullptr;
+        inline static thread_local uint32_t s_curWorkerIndex = 0;
+        inline static thread_local TaskFiber* s_curFiber = nullptr;
+
+        // fiber中的代码只通过这些函数读取上面的线程局部变量，见DT_NOINLINE
+        DT_NOINLINE static ThreadPool* GetCurPool();
+        DT_NOINLINE static uint32_t GetCurWorkerIndex();
+        DT_NOINLINE static TaskFiber* GetCurFiber();
+
+        void Push(Task&& task, int32_t priority);
+        template <typename F>
+        void PushMany(const F& task, uint32_t count, int32_t priority);
+        void Wake(uint32_t count);
+        void PushBackground(BackgroundTask&& task);
+        bool CanRunBackground() const;
+        bool TryRunBackground();
+        void PinCurrentThread(uint32_t workerIndex) const;
+        bool TryAcquire(uint32_t workerIndex, Task& task);
+        bool PopInjected(uint32_t level, uint32_t workerIndex, Task& task);
+        void Worker(uint32_t workerIndex);
+        TaskFiber* AcquireFiber(Task&& task);
+        bool PopReadyFiber(TaskFiber*& fiber);
+        void RunFiber(uint32_t workerIndex, TaskFiber* fiber);
+
+        static void FiberMain(void* arg);
+        static uint32_t GetPriorityLevel(const int32_t priority) { return priority > 0 ? 0 : priority == 0 ? 1 : 2; }
     };
 
+    template <typename T>
+    void ThreadPool::TaskRing<T>::PushBack(T&& task)
+    {
+        auto capacity = static_cast<uint32_t>(tasks.size());
+        if (count == capacity)
+        {
+            vec<T> newTasks((std::max)(capacity * 2, 16u));
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                newTasks[i] = std::move(tasks[(head + i) % capacity]);
+            }
+
+            tasks = std::move(newTasks);
+            head = 0;
+            capacity = static_cast<uint32_t>(tasks.size());
+        }
+
+        tasks[(head + count) % capacity] = std::move(task);
+        ++count;
+    }
+
+    template <typename T>
+    T ThreadPool::TaskRing<T>::PopBack()
+    {
+        assert(count > 0);
+
+        --count;
+        return std::move(tasks[(head + count) % tasks.size()]);
+    }
+
+    template <typename T>
+    T ThreadPool::TaskRing<T>::PopFront()
+    {
+        assert(count > 0);
+
+        auto task = std::move(tasks[head]);
+        head = (head + 1) % static_cast<uint32_t>(tasks.size());
+        --count;
+        return task;
+    }
+
     template <typename F>
     void ThreadPool::Run(F&& task, int32_t priority)
     {
-        std::lock_guard lock(m_taskMutex);
-        m_tasks.emplace(priority, std::forward<F>(task));
-        m_taskCond.notify_all();
+        Push(Task(std::forward<F>(task)), priority);
+    }
+
+    template <typename F>
+    void ThreadPool::RunMany(const F& task, const uint32_t count, const int32_t priority)
+    {
+        PushMany(task, count, priority);
+    }
+
+    template <typename F>
+    void ThreadPool::PushMany(const F& task, const uint32_t count, const int32_t priority)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+
+        m_pendingCount.fetch_add(count);
+
+        auto level = GetPriorityLevel(priority);
+        uint32_t pushed = 0;
+        if (GetCurPool() == this)
+        {
+            auto& deque = m_workers[GetCurWorkerIndex()]->deques[level];
+            for (; pushed < count; ++pushed)
+            {
+                Task copy(task);
+                if (!deque.Push(copy))
+                {
+                    break;
+                }
+            }
+        }
+
+        if (pushed < count)
+        {
+            std::lock_guard lock(m_injectQueue.mutex);
+            m_injectQueue.count.fetch_add(count - pushed);
+            for (; pushed < count; ++pushed)
+            {
+                m_injectQueue.tasks[level].PushBack(Task(task));
+            }
+        }
+
+        Wake(count);
+    }
+
+    template <typename F>
+    void ThreadPool::RunBackground(F&& task)
+    {
+        PushBackground(BackgroundTask(std::forward<F>(task)));
     }
 }